@@ -0,0 +1,232 @@
+#ifndef MPI_OPERATOR_H
+#define MPI_OPERATOR_H
+
+// -----------------------------------------------------------------------------
+// Matrix-vector operator interface and file helpers (header-only, C++)
+// -----------------------------------------------------------------------------
+// Shared by MPI_Matrix_Vector.cpp and MPI_Matrix_Vector_Operator.cpp. The
+// matvec is written once, against an *operator* interface, and instantiated
+// for each operator type as a template parameter:
+//
+//   struct SomeOperator
+//   {
+//       size_t rows() const;
+//       // Call visit(j, A(i, j)) for every (potentially) nonzero entry of row i.
+//       template <class Visit> void row(size_t i, Visit visit) const;
+//   };
+//
+// Because the operator is a template parameter, visit() is inlined and the
+// dense instantiation compiles to the plain row-times-vector loop.
+//
+// Usage:
+//   #include "../MPI_Common/MPI_Operator.h"
+//   ...
+//   DenseOperator A = { rows, cols, rowBegin, localRows };
+//   applyRows(A, rowBegin, rowEnd, x, y);
+// -----------------------------------------------------------------------------
+
+#include <stdio.h>   // For FILE*, fopen, fscanf, fprintf, fclose
+#include <stdlib.h>  // For posix_memalign, free
+#include <stddef.h>  // For size_t
+#include <limits.h>  // For INT_MAX
+#include <mpi.h>     // MPI library
+
+#if defined(_WIN32)
+#include <malloc.h>    // For _aligned_malloc
+#else
+#include <sys/mman.h>  // For madvise
+#endif
+
+// Block size used to describe more than INT_MAX doubles with one datatype.
+static const long long BIG_CHUNK = 1LL << 30;
+
+// -----------------------------------------------------------------------------
+// allocDoubles / freeDoubles
+// -----------------------------------------------------------------------------
+// Matrix and vector buffers, with the rules of matvec_alloc in
+// MPI_Matrix_Vector_General.c: MATVEC_ALIGN-byte aligned (one AVX-512 vector
+// / cache line); on Linux, buffers of at least one huge page are aligned to
+// HUGE_PAGE_SIZE and advised with MADV_HUGEPAGE. Returns NULL when out of
+// memory; release with freeDoubles.
+// -----------------------------------------------------------------------------
+static const size_t MATVEC_ALIGN   = 64;
+static const size_t HUGE_PAGE_SIZE = (size_t)2 << 20;
+
+inline double* allocDoubles(size_t count)
+{
+    size_t bytes = (count > 0 ? count : 1) * sizeof(double);
+
+#if defined(_WIN32)
+    return (double*)_aligned_malloc(bytes, MATVEC_ALIGN);
+#else
+    size_t align = (bytes >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : MATVEC_ALIGN;
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, align, bytes) != 0)
+        return NULL;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // Advisory only: failure just means regular 4 KiB pages.
+    if (align == HUGE_PAGE_SIZE)
+        madvise(ptr, (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1), MADV_HUGEPAGE);
+#endif
+    return (double*)ptr;
+#endif
+}
+
+inline void freeDoubles(double* ptr)
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// returnSize
+// -----------------------------------------------------------------------------
+// Number of doubles stored in a text file (vector length, or number of
+// matrix entries), or -1 if the file cannot be opened. Counting stops at the
+// first entry that is not a number.
+// -----------------------------------------------------------------------------
+inline long long returnSize(const char* fname)
+{
+    FILE* f = fopen(fname, "r");
+    if (!f)
+        return -1;
+
+    long long dim = 0;
+    double tmp;
+    while (fscanf(f, "%lf", &tmp) == 1)
+        dim++;
+
+    fclose(f);
+    return dim;
+}
+
+// -----------------------------------------------------------------------------
+// loadDoubles
+// -----------------------------------------------------------------------------
+// Allocates (allocDoubles) and reads the first 'count' doubles of a text file
+// (a vector, or a matrix in row-major order). Returns NULL if the file is
+// missing, short or malformed, or memory runs out; otherwise the caller
+// releases it with freeDoubles.
+// -----------------------------------------------------------------------------
+inline double* loadDoubles(const char* fname, size_t count)
+{
+    FILE* f = fopen(fname, "r");
+    if (!f)
+        return NULL;
+
+    double* res = allocDoubles(count);
+    if (!res)
+    {
+        fclose(f);
+        return NULL;
+    }
+    for (size_t i = 0; i != count; ++i)
+    {
+        if (fscanf(f, "%lf", &res[i]) != 1)
+        {
+            freeDoubles(res);
+            fclose(f);
+            return NULL;
+        }
+    }
+
+    fclose(f);
+    return res;
+}
+
+// -----------------------------------------------------------------------------
+// logRes
+// -----------------------------------------------------------------------------
+// Writes the result vector to a text file, one line with all values
+// separated by spaces.
+// -----------------------------------------------------------------------------
+inline void logRes(const char* fname, const double* res, size_t n)
+{
+    FILE* f = fopen(fname, "w");
+    if (!f)
+        return;
+    for (size_t i = 0; i != n; ++i)
+        fprintf(f, "%lf ", res[i]);
+    fclose(f);
+}
+
+// -----------------------------------------------------------------------------
+// makeRowType
+// -----------------------------------------------------------------------------
+// Creates a committed datatype describing 'count' contiguous doubles (one
+// matrix row, or the whole vector). Counts in MPI calls are then numbers of
+// rows, which stay far below INT_MAX even when the number of matrix elements
+// does not. Rows longer than INT_MAX doubles are described as a vector of
+// BIG_CHUNK-sized blocks plus a remainder. Caller frees with MPI_Type_free.
+// -----------------------------------------------------------------------------
+inline void makeRowType(long long count, MPI_Datatype* type)
+{
+    if (count <= INT_MAX)
+    {
+        MPI_Type_contiguous((int)count, MPI_DOUBLE, type);
+    }
+    else
+    {
+        long long nchunks = count / BIG_CHUNK;
+        long long rem     = count % BIG_CHUNK;
+
+        MPI_Datatype parts[2];
+        int          blocklens[2] = { 1, 1 };
+        MPI_Aint     displs[2]    = { 0, (MPI_Aint)(nchunks * BIG_CHUNK * (long long)sizeof(double)) };
+
+        MPI_Type_vector((int)nchunks, (int)BIG_CHUNK, (int)BIG_CHUNK, MPI_DOUBLE, &parts[0]);
+        MPI_Type_contiguous((int)rem, MPI_DOUBLE, &parts[1]);
+        MPI_Type_create_struct(rem > 0 ? 2 : 1, blocklens, displs, parts, type);
+        MPI_Type_free(&parts[0]);
+        MPI_Type_free(&parts[1]);
+    }
+    MPI_Type_commit(type);
+}
+
+// -----------------------------------------------------------------------------
+// DenseOperator
+// -----------------------------------------------------------------------------
+// An m x n matrix of which the global rows [rowBegin, rowBegin + localRows)
+// are held in memory, row-major with n doubles per row. Only those rows may
+// be visited.
+// -----------------------------------------------------------------------------
+struct DenseOperator
+{
+    size_t m;              // global number of rows
+    size_t n;              // number of columns (length of x)
+    size_t rowBegin;       // global index of the first local row
+    const double* local;   // local rows, row-major
+
+    size_t rows() const { return m; }
+
+    template <class Visit>
+    void row(size_t i, Visit visit) const
+    {
+        const double* r = local + (i - rowBegin) * n;
+        for (size_t j = 0; j != n; ++j)
+            visit(j, r[j]);
+    }
+};
+
+// -----------------------------------------------------------------------------
+// applyRows
+// -----------------------------------------------------------------------------
+// The one matvec kernel: y[i - rowBegin] = sum_j A(i, j) * x[j] for the
+// global rows [rowBegin, rowEnd), for any operator type.
+// -----------------------------------------------------------------------------
+template <class Operator>
+void applyRows(const Operator& A, size_t rowBegin, size_t rowEnd,
+               const double* x, double* y)
+{
+    for (size_t i = rowBegin; i != rowEnd; ++i)
+    {
+        double s = 0;
+        A.row(i, [&](size_t j, double a) { s += a * x[j]; });
+        y[i - rowBegin] = s;
+    }
+}
+
+#endif // MPI_OPERATOR_H
@@ -0,0 +1,412 @@
+#ifndef MPI_TOPOLOGY_H
+#define MPI_TOPOLOGY_H
+
+/*
+ * Rank and thread pinning with a topology report (header-only).
+ *
+ * Shared by the benchmark programs so their timings are repeatable:
+ *  - Discovers cores, SMT siblings, caches and NUMA nodes from /sys
+ *    (Linux). Only CPUs in the launcher-provided affinity mask are used.
+ *  - Binds each rank, and each of its OpenMP threads, with sched_setaffinity
+ *    according to a policy:
+ *      compact  fill physical cores in order (node by node), T cores per rank
+ *      scatter  round-robin ranks over NUMA nodes, T cores per rank
+ *      numa     one rank per NUMA node; the rank may use the whole node
+ *    where T = OpenMP threads per rank (1 without OpenMP). SMT siblings are
+ *    only used once every physical core has been handed out.
+ *  - Prints the topology and a rank/thread -> CPU placement map on rank 0.
+ *
+ * On other platforms discovery is unavailable and binding is a no-op
+ * (the report says so).
+ *
+ * Usage:
+ *   #define _GNU_SOURCE            (before any system header, Linux only)
+ *   #include "../MPI_Common/MPI_Topology.h"
+ *   ...
+ *   TopoBindPolicy policy;
+ *   if (topo_parse_policy("compact", &policy) == 0)
+ *       topo_bind_and_report(MPI_COMM_WORLD, policy);   (collective)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#if defined(__linux__)
+#if !defined(_GNU_SOURCE)
+#error "MPI_Topology.h: define _GNU_SOURCE before including any system header"
+#endif
+#include <sched.h>
+#define TOPO_HAVE_SYSFS 1
+#else
+#define TOPO_HAVE_SYSFS 0
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Root of the sysfs CPU/NUMA tree (overridable, e.g. for containers). */
+#ifndef TOPO_SYSFS_ROOT
+#define TOPO_SYSFS_ROOT "/sys/devices/system"
+#endif
+
+#define TOPO_MAX_CPUS    1024
+#define TOPO_MAX_THREADS 256
+#define TOPO_LINE        256
+
+typedef enum {
+    TOPO_BIND_NONE = 0,
+    TOPO_BIND_COMPACT,
+    TOPO_BIND_SCATTER,
+    TOPO_BIND_NUMA
+} TopoBindPolicy;
+
+typedef struct {
+    int cpu;       /* logical CPU number */
+    int package;   /* physical_package_id */
+    int core;      /* core_id (unique within a package) */
+    int node;      /* NUMA node */
+    int primary;   /* 1 for the first hardware thread of its core */
+} TopoCpu;
+
+typedef struct {
+    int     ncpus;
+    TopoCpu cpu[TOPO_MAX_CPUS];
+    int     nnodes;
+    int     npackages;
+    int     ncores;
+    char    caches[TOPO_LINE];
+} Topology;
+
+static inline const char *topo_policy_name(TopoBindPolicy policy)
+{
+    switch (policy) {
+    case TOPO_BIND_COMPACT: return "compact";
+    case TOPO_BIND_SCATTER: return "scatter";
+    case TOPO_BIND_NUMA:    return "numa";
+    default:                return "none";
+    }
+}
+
+/* Returns 0 on success, -1 for an unknown policy name. */
+static inline int topo_parse_policy(const char *s, TopoBindPolicy *policy)
+{
+    if      (strcmp(s, "none") == 0)    *policy = TOPO_BIND_NONE;
+    else if (strcmp(s, "compact") == 0) *policy = TOPO_BIND_COMPACT;
+    else if (strcmp(s, "scatter") == 0) *policy = TOPO_BIND_SCATTER;
+    else if (strcmp(s, "numa") == 0)    *policy = TOPO_BIND_NUMA;
+    else return -1;
+    return 0;
+}
+
+#if TOPO_HAVE_SYSFS
+
+/* Read the first line of a sysfs file; returns 0 on success. */
+static inline int topo_read_line(const char *path, char *buf, size_t len)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    int ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    if (!ok) return -1;
+
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+static inline int topo_read_int(const char *path, int fallback)
+{
+    char buf[64];
+    return (topo_read_line(path, buf, sizeof buf) == 0) ? atoi(buf) : fallback;
+}
+
+/*
+ * Parse a sysfs CPU list such as "0-3,8,10-11" into flags[0..max).
+ * Returns the number of CPUs in the list.
+ */
+static inline int topo_parse_cpulist(const char *s, unsigned char *flags, int max)
+{
+    int count = 0;
+
+    while (*s) {
+        char *end;
+        long a = strtol(s, &end, 10);
+        if (end == s) break;
+        long b = a;
+        s = end;
+        if (*s == '-') {
+            b = strtol(s + 1, &end, 10);
+            s = end;
+        }
+        for (long c = a; c <= b; c++) {
+            if (c >= 0 && c < max && flags) flags[c] = 1;
+            count++;
+        }
+        if (*s == ',') s++;
+    }
+    return count;
+}
+
+/* Order: NUMA node, package, core, logical CPU. */
+static inline int topo_cmp_cpu(const void *a, const void *b)
+{
+    const TopoCpu *x = (const TopoCpu *)a, *y = (const TopoCpu *)b;
+    if (x->node != y->node)       return x->node - y->node;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->core != y->core)       return x->core - y->core;
+    return x->cpu - y->cpu;
+}
+
+/* Discover the CPUs this process may run on. Returns 0 on success. */
+static inline int topo_discover(Topology *t)
+{
+    char path[TOPO_LINE];
+    char buf[4096];
+
+    memset(t, 0, sizeof *t);
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof allowed, &allowed) != 0) return -1;
+
+    /* NUMA node of every CPU (node 0 if the kernel has no NUMA info). */
+    static int node_of[TOPO_MAX_CPUS];
+    for (int c = 0; c < TOPO_MAX_CPUS; c++) node_of[c] = 0;
+
+    unsigned char node_online[TOPO_MAX_CPUS] = { 0 };
+    snprintf(path, sizeof path, "%s/node/online", TOPO_SYSFS_ROOT);
+    if (topo_read_line(path, buf, sizeof buf) == 0) {
+        topo_parse_cpulist(buf, node_online, TOPO_MAX_CPUS);
+        for (int nd = 0; nd < TOPO_MAX_CPUS; nd++) {
+            if (!node_online[nd]) continue;
+            unsigned char cpus[TOPO_MAX_CPUS] = { 0 };
+            snprintf(path, sizeof path, "%s/node/node%d/cpulist", TOPO_SYSFS_ROOT, nd);
+            if (topo_read_line(path, buf, sizeof buf) != 0) continue;
+            topo_parse_cpulist(buf, cpus, TOPO_MAX_CPUS);
+            for (int c = 0; c < TOPO_MAX_CPUS; c++) {
+                if (cpus[c]) node_of[c] = nd;
+            }
+        }
+    }
+
+    unsigned char online[TOPO_MAX_CPUS] = { 0 };
+    snprintf(path, sizeof path, "%s/cpu/online", TOPO_SYSFS_ROOT);
+    if (topo_read_line(path, buf, sizeof buf) != 0) return -1;
+    topo_parse_cpulist(buf, online, TOPO_MAX_CPUS);
+
+    for (int c = 0; c < TOPO_MAX_CPUS && c < CPU_SETSIZE; c++) {
+        if (!online[c] || !CPU_ISSET(c, &allowed)) continue;
+
+        TopoCpu *tc = &t->cpu[t->ncpus++];
+        tc->cpu = c;
+        tc->node = node_of[c];
+        snprintf(path, sizeof path, "%s/cpu/cpu%d/topology/physical_package_id", TOPO_SYSFS_ROOT, c);
+        tc->package = topo_read_int(path, 0);
+        snprintf(path, sizeof path, "%s/cpu/cpu%d/topology/core_id", TOPO_SYSFS_ROOT, c);
+        tc->core = topo_read_int(path, c);
+    }
+    if (t->ncpus == 0) return -1;
+
+    qsort(t->cpu, (size_t)t->ncpus, sizeof(TopoCpu), topo_cmp_cpu);
+
+    /* Count nodes/packages/cores; the first CPU of each (package, core) is primary. */
+    for (int i = 0; i < t->ncpus; i++) {
+        TopoCpu *tc = &t->cpu[i];
+        int new_core = (i == 0) || tc->package != t->cpu[i - 1].package ||
+                       tc->core != t->cpu[i - 1].core || tc->node != t->cpu[i - 1].node;
+        tc->primary = new_core;
+        t->ncores += new_core;
+        if (i == 0 || tc->node != t->cpu[i - 1].node) t->nnodes++;
+    }
+
+    unsigned char pkg_seen[TOPO_MAX_CPUS] = { 0 };
+    for (int i = 0; i < t->ncpus; i++) {
+        int pk = t->cpu[i].package;
+        if (pk >= 0 && pk < TOPO_MAX_CPUS && !pkg_seen[pk]) {
+            pkg_seen[pk] = 1;
+            t->npackages++;
+        }
+    }
+
+    /* Cache hierarchy as seen from the first allowed CPU. */
+    size_t used = 0;
+    t->caches[0] = '\0';
+    for (int idx = 0; idx < 8; idx++) {
+        char level[16], type[32], size[32], shared[1024];
+        int c0 = t->cpu[0].cpu;
+
+        snprintf(path, sizeof path, "%s/cpu/cpu%d/cache/index%d/level", TOPO_SYSFS_ROOT, c0, idx);
+        if (topo_read_line(path, level, sizeof level) != 0) break;
+        snprintf(path, sizeof path, "%s/cpu/cpu%d/cache/index%d/type", TOPO_SYSFS_ROOT, c0, idx);
+        if (topo_read_line(path, type, sizeof type) != 0) strcpy(type, "Unified");
+        snprintf(path, sizeof path, "%s/cpu/cpu%d/cache/index%d/size", TOPO_SYSFS_ROOT, c0, idx);
+        if (topo_read_line(path, size, sizeof size) != 0) strcpy(size, "?");
+        snprintf(path, sizeof path, "%s/cpu/cpu%d/cache/index%d/shared_cpu_list", TOPO_SYSFS_ROOT, c0, idx);
+        int sharing = (topo_read_line(path, shared, sizeof shared) == 0)
+                    ? topo_parse_cpulist(shared, NULL, TOPO_MAX_CPUS) : 1;
+
+        const char *suffix = (strcmp(type, "Data") == 0) ? "d"
+                           : (strcmp(type, "Instruction") == 0) ? "i" : "";
+        int w = snprintf(t->caches + used, sizeof t->caches - used, "%sL%s%s %s/%d cpu",
+                         used ? ", " : "", level, suffix, size, sharing);
+        if (w < 0 || (size_t)w >= sizeof t->caches - used) break;
+        used += (size_t)w;
+    }
+    return 0;
+}
+
+/*
+ * CPUs assigned to local rank lr for nthreads threads under policy.
+ * Fills cpus[0..nthreads) (thread t -> cpus[t]) and mask (whole rank).
+ */
+static inline void topo_assign(const Topology *t, TopoBindPolicy policy, int lr,
+                               int nthreads, int *cpus, cpu_set_t *mask)
+{
+    /* Candidate order: primaries first, then SMT siblings (both node-major). */
+    int order[TOPO_MAX_CPUS];
+    int norder = 0;
+    for (int pass = 1; pass >= 0; pass--) {
+        for (int i = 0; i < t->ncpus; i++) {
+            if (t->cpu[i].primary == pass) order[norder++] = i;
+        }
+    }
+
+    CPU_ZERO(mask);
+
+    if (policy == TOPO_BIND_COMPACT) {
+        for (int th = 0; th < nthreads; th++) {
+            cpus[th] = t->cpu[order[((long)lr * nthreads + th) % norder]].cpu;
+            CPU_SET(cpus[th], mask);
+        }
+        return;
+    }
+
+    /* scatter / numa: work inside one NUMA node. */
+    int node_rank = lr % t->nnodes;
+    int slot      = lr / t->nnodes;
+
+    int node_ids[TOPO_MAX_CPUS];
+    int nnode_ids = 0;
+    for (int i = 0; i < t->ncpus; i++) {
+        if (i == 0 || t->cpu[i].node != t->cpu[i - 1].node) node_ids[nnode_ids++] = t->cpu[i].node;
+    }
+    int node = node_ids[node_rank];
+
+    int local[TOPO_MAX_CPUS];
+    int nlocal = 0;
+    for (int k = 0; k < norder; k++) {
+        if (t->cpu[order[k]].node == node) local[nlocal++] = t->cpu[order[k]].cpu;
+    }
+
+    if (policy == TOPO_BIND_NUMA) {
+        for (int k = 0; k < nlocal; k++) CPU_SET(local[k], mask);
+        for (int th = 0; th < nthreads; th++) cpus[th] = local[th % nlocal];
+    } else {
+        for (int th = 0; th < nthreads; th++) {
+            cpus[th] = local[((long)slot * nthreads + th) % nlocal];
+            CPU_SET(cpus[th], mask);
+        }
+    }
+}
+
+#endif /* TOPO_HAVE_SYSFS */
+
+/*
+ * Bind the calling rank and its OpenMP threads, then print the topology and
+ * placement map on rank 0 of comm. Collective over comm.
+ */
+static inline void topo_bind_and_report(MPI_Comm comm, TopoBindPolicy policy)
+{
+    int rank, p;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &p);
+
+    /* Node-local rank decides the placement on each host. */
+    MPI_Comm node_comm;
+    int lr, lsize;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &lr);
+    MPI_Comm_size(node_comm, &lsize);
+    MPI_Comm_free(&node_comm);
+
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    if (nthreads > TOPO_MAX_THREADS) nthreads = TOPO_MAX_THREADS;
+
+    char host[MPI_MAX_PROCESSOR_NAME];
+    int host_len;
+    MPI_Get_processor_name(host, &host_len);
+
+    char line[TOPO_LINE];
+    char summary[2 * TOPO_LINE] = "topology discovery not supported on this platform; no binding";
+
+#if TOPO_HAVE_SYSFS
+    static Topology topo;
+    int cpus[TOPO_MAX_THREADS];
+
+    if (topo_discover(&topo) != 0) {
+        snprintf(summary, sizeof summary, "cannot read %s; no binding", TOPO_SYSFS_ROOT);
+        snprintf(line, sizeof line, "%.64s rank %d: unbound", host, rank);
+    } else {
+        snprintf(summary, sizeof summary,
+                 "%d package(s), %d NUMA node(s), %d core(s), %d hw thread(s) usable; caches: %s",
+                 topo.npackages, topo.nnodes, topo.ncores, topo.ncpus, topo.caches);
+
+        if (policy != TOPO_BIND_NONE) {
+            cpu_set_t mask;
+            topo_assign(&topo, policy, lr, nthreads, cpus, &mask);
+            sched_setaffinity(0, sizeof mask, &mask);
+
+#ifdef _OPENMP
+            /* sched_setaffinity(0, ...) applies to the calling thread only. */
+            #pragma omp parallel num_threads(nthreads)
+            {
+                cpu_set_t one;
+                CPU_ZERO(&one);
+                CPU_SET(cpus[omp_get_thread_num()], &one);
+                sched_setaffinity(0, sizeof one, &one);
+            }
+#endif
+        }
+
+        /* Where each thread actually runs now. */
+        int actual[TOPO_MAX_THREADS];
+#ifdef _OPENMP
+        #pragma omp parallel num_threads(nthreads)
+        actual[omp_get_thread_num()] = sched_getcpu();
+#else
+        actual[0] = sched_getcpu();
+#endif
+        int used = snprintf(line, sizeof line, "%.64s rank %d (local %d/%d): cpu", host, rank, lr, lsize);
+        for (int th = 0; th < nthreads && used > 0 && used < (int)sizeof line; th++) {
+            used += snprintf(line + used, sizeof line - (size_t)used, "%s%d", th ? "," : " ", actual[th]);
+        }
+    }
+#else
+    (void)lr;
+    snprintf(line, sizeof line, "%.64s rank %d (local %d/%d): unbound", host, rank, lr, lsize);
+#endif
+
+    char *all = NULL;
+    if (rank == 0) {
+        all = (char *)malloc((size_t)p * TOPO_LINE);
+    }
+    MPI_Gather(line, TOPO_LINE, MPI_CHAR, all, TOPO_LINE, MPI_CHAR, 0, comm);
+
+    if (rank == 0) {
+        printf("Topology (rank 0 host): %s\n", summary);
+        printf("Placement (policy %s, %d thread(s) per rank):\n", topo_policy_name(policy), nthreads);
+        for (int i = 0; all && i < p; i++) {
+            printf("  %s\n", &all[(size_t)i * TOPO_LINE]);
+        }
+        fflush(stdout);
+        free(all);
+    }
+}
+
+#endif /* MPI_TOPOLOGY_H */
@@ -0,0 +1,744 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <mpi.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * Distributed dense linear solve: A x = b by LU factorization with partial
+ * pivoting (P A = L U), then forward and back substitution.
+ *
+ * Key features:
+ *  - Same input files and loaders as MPI_Matrix_Vector_General (A square).
+ *  - 2D block-cyclic layout on a Pr x Pc Cartesian grid: nb x nb block (I, J)
+ *    lives on process (I mod Pr, J mod Pc), so every rank keeps a share of
+ *    the shrinking trailing matrix until the last panels.
+ *  - Right-looking blocked factorization, one nb-wide panel at a time:
+ *      1. panel factorization inside the owning process column (pivot search
+ *         with one MPI_Allreduce MAXLOC per column, see factor_panel)
+ *      2. the panel's row interchanges applied to all other columns
+ *      3. L panel broadcast along process rows
+ *      4. U12 = L11^-1 A12 on the diagonal process row, broadcast down
+ *         process columns
+ *      5. trailing update A22 -= L21 U12 (OpenMP, vectorized inner loop)
+ *    Every element sees its updates in the same order on any grid, so the
+ *    factors do not depend on the number of processes for a fixed nb.
+ *  - Triangular solves by block rows: partial sums reduced along the process
+ *    row, diagonal block solved by its owner, piece of x broadcast.
+ *  - Per phase: time (max over ranks), GFLOP/s and load balance (mean / max
+ *    busy time). With --efficiency rank 0 first repeats the factorization
+ *    and solve alone (1 x 1 grid) and the parallel efficiency T1 / (p Tp) of
+ *    every phase is reported as well.
+ *
+ * Input format (whitespace separated doubles):
+ *  - Vector file: n doubles (right-hand side b)
+ *  - Matrix file: n*n doubles in row-major order
+ *
+ * Usage:
+ *   mpiexec -n <p> MPI_LU_Solve <vector_file> <matrix_file> [options]
+ *
+ * Options:
+ *   --block=NB  block-cyclic block size and panel width (default 64)
+ *   --grid=RxC  process grid (R * C must equal p; default MPI_Dims_create)
+ *   --efficiency  also time the whole solve on rank 0 alone and report the
+ *             parallel efficiency of each phase
+ *
+ * Output (rank 0):
+ *   Solution.txt containing the n doubles of x (space-separated)
+ *   the scaled residual ||b - A x|| / (||A|| ||x|| + ||b||) (infinity norms)
+ */
+
+/* Phases of the factorization and solve that are timed separately. */
+enum { PH_PANEL = 0, PH_SWAP, PH_BCAST, PH_TRSM, PH_UPDATE, PH_SOLVE, PH_COUNT };
+
+static const char *phase_name[PH_COUNT] = {
+    "panel factorization", "row interchanges", "panel broadcasts",
+    "U12 triangular solve", "trailing update", "triangular solves"
+};
+
+/* Accumulated time and local flops per phase on one rank. */
+typedef struct {
+    double t[PH_COUNT];
+    double flops[PH_COUNT];
+} PhaseStats;
+
+static void die_rank0_abort(MPI_Comm comm, int rank, const char *msg)
+{
+    if (rank == 0) {
+        fprintf(stderr, "ERROR: %s\n", msg);
+    }
+    MPI_Abort(comm, 1);
+}
+
+/* Count how many doubles are present in a file (vector size / matrix entries). */
+static long long count_doubles_in_file(const char *fname)
+{
+    FILE *f = fopen(fname, "r");
+    if (!f) return -1;
+
+    long long count = 0;
+    double tmp;
+    while (fscanf(f, "%lf", &tmp) == 1) {
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+static double *load_vector(const char *fname, size_t n)
+{
+    FILE *f = fopen(fname, "r");
+    if (!f) return NULL;
+
+    double *x = (double *)malloc(n * sizeof(double));
+    if (!x) { fclose(f); return NULL; }
+
+    for (size_t i = 0; i < n; i++) {
+        if (fscanf(f, "%lf", &x[i]) != 1) {
+            free(x);
+            fclose(f);
+            return NULL;
+        }
+    }
+    fclose(f);
+    return x;
+}
+
+static double *load_matrix(const char *fname, size_t m, size_t n)
+{
+    FILE *f = fopen(fname, "r");
+    if (!f) return NULL;
+
+    size_t count = m * n;
+    double *A = (double *)malloc(count * sizeof(double));
+    if (!A) { fclose(f); return NULL; }
+
+    for (size_t i = 0; i < count; i++) {
+        if (fscanf(f, "%lf", &A[i]) != 1) {
+            free(A);
+            fclose(f);
+            return NULL;
+        }
+    }
+    fclose(f);
+    return A;
+}
+
+static void write_result(const char *fname, const double *y, size_t n)
+{
+    FILE *f = fopen(fname, "w");
+    if (!f) return;
+
+    for (size_t i = 0; i < n; i++) {
+        fprintf(f, "%lf%s", y[i], (i + 1 == n) ? "" : " ");
+    }
+    fprintf(f, "\n");
+    fclose(f);
+}
+
+/*
+ * Block-cyclic index helpers (nb-sized blocks dealt round-robin over P
+ * processes). numroc(g, ...) is the number of the first g global indices
+ * that process me holds, which is also the local index of the first global
+ * index >= g on me.
+ */
+static long long numroc(long long g, long long nb, int me, int P)
+{
+    long long blocks = g / nb;
+    long long count = (blocks / P) * nb;
+    long long extra = blocks % P;
+
+    if (me < extra) count += nb;
+    else if (me == extra) count += g % nb;
+    return count;
+}
+
+static int owner_of(long long g, long long nb, int P)
+{
+    return (int)((g / nb) % P);
+}
+
+static long long local_index(long long g, long long nb, int P)
+{
+    return (g / nb / P) * nb + g % nb;
+}
+
+static long long global_index(long long l, long long nb, int me, int P)
+{
+    return ((l / nb) * P + me) * nb + l % nb;
+}
+
+/* Pr x Pc grid with its process-row and process-column communicators. */
+typedef struct {
+    int dims[2];
+    int coords[2];
+    MPI_Comm cart, row_comm, col_comm;   /* row_comm rank = process column */
+} LuGrid;
+
+static void grid_setup(MPI_Comm comm, const int dims[2], LuGrid *g)
+{
+    int periods[2] = { 0, 0 };
+    int keep_row[2] = { 0, 1 }, keep_col[2] = { 1, 0 };
+    int rank;
+
+    g->dims[0] = dims[0];
+    g->dims[1] = dims[1];
+    MPI_Cart_create(comm, 2, g->dims, periods, 0, &g->cart);
+    MPI_Comm_rank(g->cart, &rank);
+    MPI_Cart_coords(g->cart, rank, 2, g->coords);
+    MPI_Cart_sub(g->cart, keep_row, &g->row_comm);
+    MPI_Cart_sub(g->cart, keep_col, &g->col_comm);
+}
+
+static void grid_free(LuGrid *g)
+{
+    MPI_Comm_free(&g->row_comm);
+    MPI_Comm_free(&g->col_comm);
+    MPI_Comm_free(&g->cart);
+}
+
+/* Block-cyclic matrix: local row-major mloc x nloc piece of the global n x n. */
+typedef struct {
+    long long n, nb;
+    long long mloc, nloc;
+    double *a;
+} LuMatrix;
+
+#define LA(M, i, j) ((M)->a[(size_t)(i) * (size_t)(M)->nloc + (size_t)(j)])
+
+/*
+ * Root deals the full row-major matrix out in the block-cyclic layout: for
+ * every rank it packs that rank's local rows and columns and sends them.
+ */
+static void distribute_matrix(const double *Afull, const LuGrid *g, LuMatrix *M, int root)
+{
+    int rank, p;
+    MPI_Comm_rank(g->cart, &rank);
+    MPI_Comm_size(g->cart, &p);
+
+    if (rank != root) {
+        MPI_Recv(M->a, (int)(M->mloc * M->nloc), MPI_DOUBLE, root, 0, g->cart, MPI_STATUS_IGNORE);
+        return;
+    }
+
+    for (int dst = 0; dst < p; dst++) {
+        int c[2];
+        MPI_Cart_coords(g->cart, dst, 2, c);
+        long long mr = numroc(M->n, M->nb, c[0], g->dims[0]);
+        long long nr = numroc(M->n, M->nb, c[1], g->dims[1]);
+        double *buf = (dst == root) ? M->a : (double *)malloc((size_t)(mr * nr) * sizeof(double) + 1);
+        if (!buf) {
+            fprintf(stderr, "ERROR: out of memory for the distribution buffer\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        for (long long li = 0; li < mr; li++) {
+            long long gi = global_index(li, M->nb, c[0], g->dims[0]);
+            for (long long lj = 0; lj < nr; lj++) {
+                long long gj = global_index(lj, M->nb, c[1], g->dims[1]);
+                buf[li * nr + lj] = Afull[(size_t)gi * (size_t)M->n + (size_t)gj];
+            }
+        }
+        if (dst != root) {
+            MPI_Send(buf, (int)(mr * nr), MPI_DOUBLE, dst, 0, g->cart);
+            free(buf);
+        }
+    }
+}
+
+/*
+ * Swap global rows r1 and r2 in local columns [c0, c1) within the process
+ * column (the two rows may live on different process rows).
+ */
+static void swap_rows(LuMatrix *M, const LuGrid *g, long long r1, long long r2,
+                      long long c0, long long c1, double *tmp)
+{
+    int Pr = g->dims[0], me = g->coords[0];
+    int o1 = owner_of(r1, M->nb, Pr), o2 = owner_of(r2, M->nb, Pr);
+    long long len = c1 - c0;
+
+    if (r1 == r2 || len <= 0 || (me != o1 && me != o2)) return;
+
+    if (o1 == o2) {
+        double *a = &LA(M, local_index(r1, M->nb, Pr), c0);
+        double *b = &LA(M, local_index(r2, M->nb, Pr), c0);
+        for (long long j = 0; j < len; j++) {
+            double t = a[j];
+            a[j] = b[j];
+            b[j] = t;
+        }
+        return;
+    }
+
+    long long mine = (me == o1) ? r1 : r2;
+    int other = (me == o1) ? o2 : o1;
+    double *row = &LA(M, local_index(mine, M->nb, Pr), c0);
+    memcpy(tmp, row, (size_t)len * sizeof(double));
+    MPI_Sendrecv(tmp, (int)len, MPI_DOUBLE, other, 1,
+                 row, (int)len, MPI_DOUBLE, other, 1, g->col_comm, MPI_STATUS_IGNORE);
+}
+
+/*
+ * Factor the jb columns starting at global column j0 inside process column
+ * pc (unblocked right-looking LU with partial pivoting on the panel only).
+ * Per column: local candidate, MPI_Allreduce MAXLOC over the process column
+ * (ties go to the lowest row, as in serial LU), swap inside the panel,
+ * broadcast of the pivot row's panel part, scaling and rank-1 update.
+ * Pivot rows go to ipiv[j0 ..]; returns the first zero pivot column + 1.
+ */
+static long long factor_panel(LuMatrix *M, const LuGrid *g, long long j0, long long jb,
+                              long long *ipiv, double *prow, double *tmp, PhaseStats *st)
+{
+    int Pr = g->dims[0], Pc = g->dims[1], me = g->coords[0];
+    long long lc0 = local_index(j0, M->nb, Pc);
+    long long info = 0;
+
+    for (long long jj = 0; jj < jb; jj++) {
+        long long j = j0 + jj;
+        long long lc = lc0 + jj;
+        long long lr = numroc(j, M->nb, me, Pr);
+
+        struct { double v; int row; } cand = { -1.0, INT_MAX }, best;
+        for (long long li = lr; li < M->mloc; li++) {
+            double v = fabs(LA(M, li, lc));
+            if (v > cand.v) {
+                cand.v = v;
+                cand.row = (int)global_index(li, M->nb, me, Pr);
+            }
+        }
+        MPI_Allreduce(&cand, &best, 1, MPI_DOUBLE_INT, MPI_MAXLOC, g->col_comm);
+        ipiv[j] = best.row;
+        if (best.v == 0.0 && info == 0) info = j + 1;
+
+        swap_rows(M, g, j, best.row, lc0, lc0 + jb, tmp);
+
+        /* Pivot row, columns j .. j0 + jb - 1. */
+        long long w = jb - jj;
+        int oj = owner_of(j, M->nb, Pr);
+        if (me == oj) {
+            memcpy(prow, &LA(M, local_index(j, M->nb, Pr), lc), (size_t)w * sizeof(double));
+        }
+        MPI_Bcast(prow, (int)w, MPI_DOUBLE, oj, g->col_comm);
+        if (prow[0] == 0.0) continue;
+
+        long long lr1 = numroc(j + 1, M->nb, me, Pr);
+        for (long long li = lr1; li < M->mloc; li++) {
+            double *a = &LA(M, li, lc);
+            double l = a[0] / prow[0];
+            a[0] = l;
+            for (long long c = 1; c < w; c++) a[c] -= l * prow[c];
+        }
+        st->flops[PH_PANEL] += (double)(M->mloc - lr1) * (double)(2 * w - 1);
+    }
+    return info;
+}
+
+/*
+ * Right-looking blocked LU of the block-cyclic M in place (unit lower L
+ * below the diagonal, U on and above it). ipiv[j] is the global row swapped
+ * with row j at step j, on every rank. Returns 0 or the first zero pivot + 1.
+ */
+static long long lu_factor(LuMatrix *M, const LuGrid *g, long long *ipiv, PhaseStats *st)
+{
+    int Pr = g->dims[0], Pc = g->dims[1];
+    int myrow = g->coords[0], mycol = g->coords[1];
+    long long n = M->n, nb = M->nb;
+    long long info = 0;
+
+    long long wmax = (M->nloc > nb) ? M->nloc : nb;
+    double *prow = (double *)malloc((size_t)nb * sizeof(double));
+    double *tmp  = (double *)malloc((size_t)wmax * sizeof(double));
+    double *Lp   = (double *)malloc((size_t)(M->mloc * nb) * sizeof(double) + 1);
+    double *Up   = (double *)malloc((size_t)(nb * M->nloc) * sizeof(double) + 1);
+    if (!prow || !tmp || !Lp || !Up) {
+        fprintf(stderr, "ERROR: out of memory for LU work buffers\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (long long j0 = 0; j0 < n; j0 += nb) {
+        long long jb = (n - j0 < nb) ? n - j0 : nb;
+        int pr = owner_of(j0, nb, Pr), pc = owner_of(j0, nb, Pc);
+        long long lr0 = numroc(j0, nb, myrow, Pr);        /* first local row >= j0 */
+        long long lrr = numroc(j0 + jb, nb, myrow, Pr);   /* first local row >= j0 + jb */
+        long long lcr = numroc(j0 + jb, nb, mycol, Pc);   /* first local column right of the panel */
+        long long lc0 = (mycol == pc) ? local_index(j0, nb, Pc) : -1;
+        long long rows = M->mloc - lr0;
+        long long cols = M->nloc - lcr;
+
+        /* 1. Panel factorization in process column pc. */
+        double t = MPI_Wtime();
+        long long pinfo = 0;
+        if (mycol == pc) {
+            pinfo = factor_panel(M, g, j0, jb, ipiv, prow, tmp, st);
+        }
+        st->t[PH_PANEL] += MPI_Wtime() - t;
+
+        /* 3a. Pivots and L panel (local rows >= j0) along each process row. */
+        t = MPI_Wtime();
+        if (mycol == pc) {
+            for (long long li = 0; li < rows; li++) {
+                memcpy(&Lp[li * jb], &LA(M, lr0 + li, lc0), (size_t)jb * sizeof(double));
+            }
+        }
+        MPI_Bcast(&ipiv[j0], (int)jb, MPI_LONG_LONG, pc, g->row_comm);
+        MPI_Bcast(&pinfo, 1, MPI_LONG_LONG, pc, g->row_comm);
+        MPI_Bcast(Lp, (int)(rows * jb), MPI_DOUBLE, pc, g->row_comm);
+        st->t[PH_BCAST] += MPI_Wtime() - t;
+        if (pinfo != 0 && info == 0) info = pinfo;
+
+        /* 2. Row interchanges on the columns left and right of the panel. */
+        t = MPI_Wtime();
+        for (long long j = j0; j < j0 + jb; j++) {
+            if (mycol == pc) {
+                swap_rows(M, g, j, ipiv[j], 0, lc0, tmp);
+                swap_rows(M, g, j, ipiv[j], lc0 + jb, M->nloc, tmp);
+            } else {
+                swap_rows(M, g, j, ipiv[j], 0, M->nloc, tmp);
+            }
+        }
+        st->t[PH_SWAP] += MPI_Wtime() - t;
+
+        if (cols == 0) continue;
+
+        /* 4. U12 = L11^-1 A12 on process row pr (L11 = first jb rows of Lp there). */
+        t = MPI_Wtime();
+        if (myrow == pr) {
+            for (long long i = 1; i < jb; i++) {
+                double *ui = &LA(M, lr0 + i, lcr);
+                for (long long p = 0; p < i; p++) {
+                    double l = Lp[i * jb + p];
+                    const double *up = &LA(M, lr0 + p, lcr);
+                    for (long long c = 0; c < cols; c++) ui[c] -= l * up[c];
+                }
+            }
+            st->flops[PH_TRSM] += (double)jb * (double)(jb - 1) * (double)cols;
+            for (long long i = 0; i < jb; i++) {
+                memcpy(&Up[i * cols], &LA(M, lr0 + i, lcr), (size_t)cols * sizeof(double));
+            }
+        }
+        st->t[PH_TRSM] += MPI_Wtime() - t;
+
+        /* 3b. U12 down each process column. */
+        t = MPI_Wtime();
+        MPI_Bcast(Up, (int)(jb * cols), MPI_DOUBLE, pr, g->col_comm);
+        st->t[PH_BCAST] += MPI_Wtime() - t;
+
+        /* 5. Trailing update A22 -= L21 U12 on local rows >= j0 + jb. */
+        t = MPI_Wtime();
+        const double *L21 = Lp + (lrr - lr0) * jb;
+        long long rows2 = M->mloc - lrr;
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < rows2; i++) {
+            double *ai = &LA(M, lrr + i, lcr);
+            for (long long p = 0; p < jb; p++) {
+                double l = L21[i * jb + p];
+                const double *up = &Up[p * cols];
+                for (long long c = 0; c < cols; c++) ai[c] -= l * up[c];
+            }
+        }
+        st->flops[PH_UPDATE] += 2.0 * (double)rows2 * (double)jb * (double)cols;
+        st->t[PH_UPDATE] += MPI_Wtime() - t;
+    }
+
+    free(prow);
+    free(tmp);
+    free(Lp);
+    free(Up);
+    return info;
+}
+
+/*
+ * Solve L U x = P b with b replicated on every rank (overwritten by x).
+ * Block row J: the ranks of its process row sum their local part of
+ * L_JK x_K (K < J, forward) or U_JK x_K (K > J, backward), MPI_Reduce
+ * brings the sums to the owner of the diagonal block, which solves its
+ * jb x jb triangle and broadcasts the new piece of x to everybody.
+ */
+static void lu_solve(const LuMatrix *M, const LuGrid *g, const long long *ipiv, double *b,
+                     PhaseStats *st)
+{
+    int Pr = g->dims[0], Pc = g->dims[1];
+    int myrow = g->coords[0], mycol = g->coords[1];
+    long long n = M->n, nb = M->nb;
+    double *sum = (double *)malloc((size_t)nb * sizeof(double));
+    double *red = (double *)malloc((size_t)nb * sizeof(double));
+    if (!sum || !red) {
+        fprintf(stderr, "ERROR: out of memory for the triangular solves\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    double t = MPI_Wtime();
+    for (long long j = 0; j < n; j++) {
+        double tmp = b[j];
+        b[j] = b[ipiv[j]];
+        b[ipiv[j]] = tmp;
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        long long nblocks = (n + nb - 1) / nb;
+        for (long long s = 0; s < nblocks; s++) {
+            long long J = (pass == 0) ? s : nblocks - 1 - s;
+            long long j0 = J * nb;
+            long long jb = (n - j0 < nb) ? n - j0 : nb;
+            int pr = owner_of(j0, nb, Pr), pc = owner_of(j0, nb, Pc);
+
+            if (myrow == pr) {
+                long long lr0 = local_index(j0, nb, Pr);
+                /* Forward: local columns < j0; backward: local columns >= j0 + jb. */
+                long long c0 = (pass == 0) ? 0 : numroc(j0 + jb, nb, mycol, Pc);
+                long long c1 = (pass == 0) ? numroc(j0, nb, mycol, Pc) : M->nloc;
+
+                for (long long i = 0; i < jb; i++) {
+                    const double *ai = &LA(M, lr0 + i, 0);
+                    double acc = 0.0;
+                    for (long long lc = c0; lc < c1; lc++) {
+                        acc += ai[lc] * b[global_index(lc, nb, mycol, Pc)];
+                    }
+                    sum[i] = acc;
+                }
+                st->flops[PH_SOLVE] += 2.0 * (double)jb * (double)(c1 - c0);
+                MPI_Reduce(sum, red, (int)jb, MPI_DOUBLE, MPI_SUM, pc, g->row_comm);
+
+                if (mycol == pc) {
+                    long long lc0 = local_index(j0, nb, Pc);
+                    for (long long i = 0; i < jb; i++) red[i] = b[j0 + i] - red[i];
+                    if (pass == 0) {
+                        for (long long i = 1; i < jb; i++) {
+                            for (long long p = 0; p < i; p++) red[i] -= LA(M, lr0 + i, lc0 + p) * red[p];
+                        }
+                    } else {
+                        for (long long i = jb - 1; i >= 0; i--) {
+                            for (long long p = i + 1; p < jb; p++) red[i] -= LA(M, lr0 + i, lc0 + p) * red[p];
+                            red[i] /= LA(M, lr0 + i, lc0 + i);
+                        }
+                    }
+                    st->flops[PH_SOLVE] += (double)jb * (double)jb;
+                    memcpy(&b[j0], red, (size_t)jb * sizeof(double));
+                }
+            }
+
+            int coords[2] = { pr, pc }, root;
+            MPI_Cart_rank(g->cart, coords, &root);
+            MPI_Bcast(&b[j0], (int)jb, MPI_DOUBLE, root, g->cart);
+        }
+    }
+    st->t[PH_SOLVE] += MPI_Wtime() - t;
+
+    free(sum);
+    free(red);
+}
+
+/*
+ * Factor and solve the full matrix on the given grid of comm (root holds
+ * Afull and b). x receives the solution on every rank; returns the info
+ * of lu_factor and fills the rank's phase statistics.
+ */
+static long long solve_on_grid(MPI_Comm comm, const int dims[2], const double *Afull,
+                               const double *b, long long n, long long nb, double *x,
+                               PhaseStats *st, double *t_total)
+{
+    LuGrid g;
+    grid_setup(comm, dims, &g);
+
+    LuMatrix M;
+    M.n = n;
+    M.nb = nb;
+    M.mloc = numroc(n, nb, g.coords[0], g.dims[0]);
+    M.nloc = numroc(n, nb, g.coords[1], g.dims[1]);
+    M.a = (double *)malloc((size_t)(M.mloc * M.nloc) * sizeof(double) + 1);
+    long long *ipiv = (long long *)malloc((size_t)n * sizeof(long long));
+    if (!M.a || !ipiv) {
+        fprintf(stderr, "ERROR: out of memory for the local matrix\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (M.mloc * M.nloc > INT_MAX) {
+        fprintf(stderr, "ERROR: local block larger than 2^31 elements, use more processes\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    int rank;
+    MPI_Comm_rank(g.cart, &rank);
+    distribute_matrix(Afull, &g, &M, 0);
+    if (rank == 0) memcpy(x, b, (size_t)n * sizeof(double));
+    MPI_Bcast(x, (int)n, MPI_DOUBLE, 0, g.cart);
+
+    memset(st, 0, sizeof *st);
+    MPI_Barrier(g.cart);
+    double t = MPI_Wtime();
+    long long info = lu_factor(&M, &g, ipiv, st);
+    if (info == 0) {
+        lu_solve(&M, &g, ipiv, x, st);
+    }
+    *t_total = MPI_Wtime() - t;
+
+    free(M.a);
+    free(ipiv);
+    grid_free(&g);
+    return info;
+}
+
+int main(int argc, char **argv)
+{
+    /* OpenMP threads compute between MPI calls; only the main thread calls MPI. */
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    if (provided < MPI_THREAD_FUNNELED) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "MPI library does not provide MPI_THREAD_FUNNELED");
+    }
+
+    long long nb = 64;
+    int dims[2] = { 0, 0 };
+    int efficiency = 0;
+    int ok = (argc >= 3);
+    for (int i = 3; ok && i < argc; i++) {
+        if (strncmp(argv[i], "--block=", 8) == 0) {
+            nb = atoll(argv[i] + 8);
+            if (nb < 1) ok = 0;
+        } else if (strncmp(argv[i], "--grid=", 7) == 0) {
+            if (sscanf(argv[i] + 7, "%dx%d", &dims[0], &dims[1]) != 2 || dims[0] < 1 || dims[1] < 1) ok = 0;
+        } else if (strcmp(argv[i], "--efficiency") == 0) {
+            efficiency = 1;
+        } else {
+            ok = 0;
+        }
+    }
+    if (!ok) {
+        if (rank == 0) {
+            fprintf(stderr, "Usage: %s <vector_file> <matrix_file> [--block=NB] [--grid=RxC] [--efficiency]\n",
+                    argv[0]);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    if (dims[0] == 0) {
+        MPI_Dims_create(p, 2, dims);
+    } else if ((long long)dims[0] * dims[1] != p) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "--grid=RxC needs R * C == number of processes");
+    }
+
+    const char *vec_file = argv[1];
+    const char *mat_file = argv[2];
+
+    /* Rank 0 determines n from the vector file and checks that A is n x n. */
+    long long n = 0;
+    if (rank == 0) {
+        n = count_doubles_in_file(vec_file);
+        if (n <= 0) {
+            fprintf(stderr, "ERROR: cannot read vector size from file '%s'\n", vec_file);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (count_doubles_in_file(mat_file) != n * n) {
+            fprintf(stderr, "ERROR: matrix file '%s' is not %lld x %lld\n", mat_file, n, n);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    MPI_Bcast(&n, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    double *Afull = NULL, *b = NULL;
+    double *x = (double *)malloc((size_t)n * sizeof(double));
+    if (!x) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for x");
+    }
+    if (rank == 0) {
+        b = load_vector(vec_file, (size_t)n);
+        Afull = load_matrix(mat_file, (size_t)n, (size_t)n);
+        if (!b || !Afull) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read input files (format/size mismatch)");
+        }
+    }
+
+    /* Optional single-process reference for the parallel efficiency. */
+    PhaseStats ref;
+    double t_ref = 0.0;
+    memset(&ref, 0, sizeof ref);
+    if (efficiency && rank == 0) {
+        int one[2] = { 1, 1 };
+        solve_on_grid(MPI_COMM_SELF, one, Afull, b, n, nb, x, &ref, &t_ref);
+    }
+
+    PhaseStats st;
+    double t_total;
+    long long info = solve_on_grid(MPI_COMM_WORLD, dims, Afull, b, n, nb, x, &st, &t_total);
+    if (info != 0) {
+        if (rank == 0) {
+            fprintf(stderr, "ERROR: matrix is singular (zero pivot in column %lld)\n", info - 1);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    PhaseStats st_max, st_sum;
+    double t_max;
+    MPI_Reduce(st.t, st_max.t, PH_COUNT, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(st.t, st_sum.t, PH_COUNT, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(st.flops, st_sum.flops, PH_COUNT, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&t_total, &t_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        write_result("Solution.txt", x, (size_t)n);
+
+        /* Scaled residual in the infinity norm. */
+        double rmax = 0.0, anorm = 0.0, xmax = 0.0, bmax = 0.0;
+        for (long long i = 0; i < n; i++) {
+            double r = b[i], rowsum = 0.0;
+            for (long long j = 0; j < n; j++) {
+                r -= Afull[(size_t)i * (size_t)n + (size_t)j] * x[j];
+                rowsum += fabs(Afull[(size_t)i * (size_t)n + (size_t)j]);
+            }
+            if (fabs(r) > rmax) rmax = fabs(r);
+            if (rowsum > anorm) anorm = rowsum;
+            if (fabs(x[i]) > xmax) xmax = fabs(x[i]);
+            if (fabs(b[i]) > bmax) bmax = fabs(b[i]);
+        }
+
+        double nn = (double)n;
+        int threads = 1;
+#ifdef _OPENMP
+        threads = omp_get_max_threads();
+#endif
+        printf("LU solve: n = %lld on a %d x %d grid, block %lld, %d thread(s) per rank\n",
+               n, dims[0], dims[1], nb, threads);
+        printf("Total %f s: factorization %.2f GFLOP/s (2/3 n^3), ||b - A x|| / (||A|| ||x|| + ||b||) = %.3e\n",
+               t_max, 2.0 / 3.0 * nn * nn * nn / (t_max - st_max.t[PH_SOLVE]) * 1e-9,
+               rmax / (anorm * xmax + bmax));
+        printf("%-22s %10s %10s %9s%s\n", "phase", "time (s)", "GFLOP/s", "balance",
+               efficiency ? "  efficiency T1/(p Tp)" : "");
+        for (int ph = 0; ph < PH_COUNT; ph++) {
+            double tp = st_max.t[ph];
+            double balance = (tp > 0.0) ? st_sum.t[ph] / p / tp : 1.0;
+            printf("%-22s %10.6f ", phase_name[ph], tp);
+            if (st_sum.flops[ph] > 0.0 && tp > 0.0) printf("%10.2f ", st_sum.flops[ph] / tp * 1e-9);
+            else printf("%10s ", "-");
+            printf("%8.1f%%", 100.0 * balance);
+            if (efficiency) {
+                if (tp > 0.0 && ref.t[ph] > 1e-6) printf("  %8.1f%%", 100.0 * ref.t[ph] / (p * tp));
+                else printf("  %9s", "-");
+            }
+            printf("\n");
+        }
+        if (efficiency) {
+            printf("Single process: %f s, speedup %.2f, parallel efficiency %.1f%%\n",
+                   t_ref, t_ref / t_max, 100.0 * t_ref / (p * t_max));
+        }
+    }
+
+    /* Cleanup */
+    free(x);
+    if (rank == 0) {
+        free(b);
+        free(Afull);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
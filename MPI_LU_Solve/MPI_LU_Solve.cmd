@@ -0,0 +1,65 @@
+@echo off
+setlocal
+
+rem --------------------------------------------------------------------
+rem  Modify PATH so MinGW DLLs are used first (prevents popup issues)
+rem --------------------------------------------------------------------
+set "PATH=C:\msys64\mingw64\bin;%PATH%"
+
+rem --------------------------------------------------------------------
+rem  Define Microsoft MPI include & library folders (NO trailing '\')
+rem --------------------------------------------------------------------
+set "MSMPI_INC=C:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+set "MSMPI_LIB64=C:\Program Files (x86)\Microsoft SDKs\MPI\Lib\x64"
+
+rem --------------------------------------------------------------------
+rem  Move to directory where the script is located
+rem --------------------------------------------------------------------
+cd /d %~dp0
+
+rem --------------------------------------------------------------------
+rem  Input files
+rem  Usage: MPI_LU_Solve.cmd [num_procs]
+rem  Vector.txt is b, Matrix.txt the n x n matrix A (row-major).
+rem --------------------------------------------------------------------
+set "VEC_FILE=Vector.txt"
+set "MAT_FILE=Matrix.txt"
+
+rem Extra program options, e.g. --block=32, --grid=2x2, --efficiency
+set "OPTIONS=--block=2"
+
+rem Optional: number of MPI processes (default = 4)
+if "%~1"=="" (
+    set NP=4
+) else (
+    set NP=%~1
+)
+
+rem --------------------------------------------------------------------
+rem  Build the MPI LU solver
+rem  -O3 -march=native vectorize the trailing update and U12 loops.
+rem  -fopenmp enables the threaded trailing update (threads per rank = OMP_NUM_THREADS).
+rem --------------------------------------------------------------------
+echo Building MPI_LU_Solve.c ...
+gcc MPI_LU_Solve.c ^
+  -O3 -fopenmp -march=native ^
+  -I"%MSMPI_INC%" ^
+  -L"%MSMPI_LIB64%" ^
+  -lmsmpi ^
+  -o MPI_LU_Solve.exe
+
+if %errorlevel% neq 0 (
+    echo [ERROR] Compilation failed!
+    exit /b 1
+)
+
+echo Build completed successfully.
+
+rem --------------------------------------------------------------------
+rem  Run the MPI program
+rem --------------------------------------------------------------------
+echo Running: mpiexec -n %NP% MPI_LU_Solve.exe %VEC_FILE% %MAT_FILE% %OPTIONS%
+echo --------------------------------------------------------------
+call mpiexec -n %NP% MPI_LU_Solve.exe "%VEC_FILE%" "%MAT_FILE%" %OPTIONS%
+
+endlocal
@@ -0,0 +1,705 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <mpi.h>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Distributed dense matrix-matrix multiplication: C = A * B (SUMMA)
+ *
+ * A is m x k, B is k x n, C is m x n. One run replaces the n matvec runs
+ * (each re-scattering A) that MPI_Matrix_Vector_General would need.
+ *
+ * Key features:
+ *  - Pr x Pc Cartesian process grid (MPI_Dims_create, or --grid). Rank (i, j)
+ *    holds the blocks A(i, j), B(i, j) and C(i, j) of an uneven 2D block
+ *    distribution: rows of A / C split over Pr, columns of B / C over Pc,
+ *    the inner dimension k over Pc for A and over Pr for B.
+ *  - SUMMA: the inner dimension is walked in panels of at most nb columns.
+ *    For every panel the owning process column broadcasts its m_i x w piece
+ *    of A along each process row, the owning process row broadcasts its
+ *    w x n_j piece of B down each process column, and every rank adds the
+ *    local product of the two panels to its C block.
+ *  - Double-buffered panels: the MPI_Ibcast of panel s + 1 is in flight while
+ *    panel s is multiplied, so broadcast time is hidden behind the GEMM
+ *    (see summa). --no-overlap uses blocking MPI_Bcast for comparison.
+ *  - Cache-blocked local GEMM: B panel columns in blocks of GEMM_NC that stay
+ *    in L2 while all row strips of A sweep over them, with a 4 x 8 register
+ *    tile micro-kernel (AVX2/FMA when built with -march=native, portable C
+ *    otherwise) and OpenMP threads over the row strips (see gemm_panel).
+ *
+ * Input format (whitespace separated doubles, row-major):
+ *  - Matrix A file: m*k doubles (m is derived from the count)
+ *  - Matrix B file: k*n doubles (n is derived from the count)
+ *
+ * Usage:
+ *   mpiexec -n <p> MPI_Matrix_Matrix_SUMMA <matrix_A_file> <matrix_B_file> <k> [options]
+ *
+ * Options:
+ *   --grid=RxC  process grid (R * C must equal p; default as square as
+ *             MPI_Dims_create makes it, longer side along the longer of m, n)
+ *   --panel=NB  SUMMA panel width (default 128)
+ *   --no-overlap  blocking panel broadcasts instead of double buffering
+ *   --verify  rank 0 recomputes C from the full matrices and reports the
+ *             maximum absolute and relative error
+ *
+ * Output (rank 0):
+ *   Result.txt containing the m*n doubles of C (row-major, space-separated)
+ */
+
+/* Register tile of the micro-kernel and column block of the B panel. */
+#define GEMM_MR  4
+#define GEMM_NR  8
+#define GEMM_NC  256
+
+/* Rows of C multiplied between two MPI progress calls (see summa). */
+#define GEMM_MC  64
+
+#define SUMMA_ALIGN 64
+
+static void die_rank0_abort(MPI_Comm comm, int rank, const char *msg)
+{
+    if (rank == 0) {
+        fprintf(stderr, "ERROR: %s\n", msg);
+    }
+    MPI_Abort(comm, 1);
+}
+
+static void *summa_alloc(size_t bytes)
+{
+    if (bytes == 0) bytes = SUMMA_ALIGN;
+
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, SUMMA_ALIGN);
+#else
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, SUMMA_ALIGN, bytes) != 0) return NULL;
+    return ptr;
+#endif
+}
+
+static void summa_free(void *ptr)
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+/* Count how many doubles are present in a file (matrix entries). */
+static long long count_doubles_in_file(const char *fname)
+{
+    FILE *f = fopen(fname, "r");
+    if (!f) return -1;
+
+    long long count = 0;
+    double tmp;
+    while (fscanf(f, "%lf", &tmp) == 1) {
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+static double *load_matrix(const char *fname, size_t m, size_t n)
+{
+    FILE *f = fopen(fname, "r");
+    if (!f) return NULL;
+
+    size_t count = m * n;
+    double *A = (double *)summa_alloc(count * sizeof(double));
+    if (!A) { fclose(f); return NULL; }
+
+    for (size_t i = 0; i < count; i++) {
+        if (fscanf(f, "%lf", &A[i]) != 1) {
+            summa_free(A);
+            fclose(f);
+            return NULL;
+        }
+    }
+    fclose(f);
+    return A;
+}
+
+static void write_result(const char *fname, const double *y, size_t n)
+{
+    FILE *f = fopen(fname, "w");
+    if (!f) return;
+
+    for (size_t i = 0; i < n; i++) {
+        fprintf(f, "%lf%s", y[i], (i + 1 == n) ? "" : " ");
+    }
+    fprintf(f, "\n");
+    fclose(f);
+}
+
+static void block_partition(long long total, int parts, long long *counts, long long *displs)
+{
+    long long q = total / parts;
+    long long r = total % parts;
+    long long disp = 0;
+
+    for (int i = 0; i < parts; i++) {
+        counts[i] = q + (i < r ? 1 : 0);
+        displs[i] = disp;
+        disp += counts[i];
+    }
+}
+
+/* Index of the block of a block_partition that contains position pos. */
+static int block_owner(const long long *counts, const long long *displs, int parts, long long pos)
+{
+    for (int i = 0; i < parts; i++) {
+        if (pos >= displs[i] && pos < displs[i] + counts[i]) return i;
+    }
+    return parts - 1;
+}
+
+/*
+ * Send (gather = 0) or collect (gather = 1) the 2D blocks of the row-major
+ * full matrix with leading dimension ld held on root. Rank k's block starts
+ * at (r0[k], c0[k]) and is nr[k] x nc[k]; it is described as a strided
+ * hvector on root, so no packing copy is made. The per-rank arrays are only
+ * significant on root; every rank passes its own block, stored contiguously.
+ */
+static void move_blocks(double *full, long long ld,
+                        const long long *r0, const long long *nr,
+                        const long long *c0, const long long *nc,
+                        double *blk, long long local_rows, long long local_cols,
+                        int gather, int root, MPI_Comm comm)
+{
+    int rank, p;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &p);
+
+    if (rank != root) {
+        if (local_rows == 0 || local_cols == 0) return;
+        MPI_Datatype row;
+        MPI_Type_contiguous((int)local_cols, MPI_DOUBLE, &row);
+        MPI_Type_commit(&row);
+        if (gather) {
+            MPI_Send(blk, (int)local_rows, row, root, 0, comm);
+        } else {
+            MPI_Recv(blk, (int)local_rows, row, root, 0, comm, MPI_STATUS_IGNORE);
+        }
+        MPI_Type_free(&row);
+        return;
+    }
+
+    for (int dst = 0; dst < p; dst++) {
+        double *src = &full[(size_t)r0[dst] * (size_t)ld + (size_t)c0[dst]];
+
+        if (dst == root) {
+            for (long long i = 0; i < nr[dst]; i++) {
+                double *a = &blk[(size_t)i * (size_t)nc[dst]];
+                double *b = &src[(size_t)i * (size_t)ld];
+                memcpy(gather ? b : a, gather ? a : b, (size_t)nc[dst] * sizeof(double));
+            }
+            continue;
+        }
+        if (nr[dst] == 0 || nc[dst] == 0) continue;
+
+        MPI_Datatype block;
+        MPI_Type_create_hvector((int)nr[dst], (int)nc[dst], (MPI_Aint)((size_t)ld * sizeof(double)),
+                                MPI_DOUBLE, &block);
+        MPI_Type_commit(&block);
+        if (gather) {
+            MPI_Recv(src, 1, block, dst, 0, comm, MPI_STATUS_IGNORE);
+        } else {
+            MPI_Send(src, 1, block, dst, 0, comm);
+        }
+        MPI_Type_free(&block);
+    }
+}
+
+/*
+ * C[0:4, 0:8] += A[0:4, 0:w] * B[0:w, 0:8]: the 4 x 8 tile of C stays in
+ * eight registers for the whole panel; per step one B row is loaded and
+ * each A element is broadcast once.
+ */
+static void micro_kernel(long long w, const double *A, long long lda,
+                         const double *B, long long ldb, double *C, long long ldc)
+{
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256d c00 = _mm256_loadu_pd(C),           c01 = _mm256_loadu_pd(C + 4);
+    __m256d c10 = _mm256_loadu_pd(C + ldc),     c11 = _mm256_loadu_pd(C + ldc + 4);
+    __m256d c20 = _mm256_loadu_pd(C + 2 * ldc), c21 = _mm256_loadu_pd(C + 2 * ldc + 4);
+    __m256d c30 = _mm256_loadu_pd(C + 3 * ldc), c31 = _mm256_loadu_pd(C + 3 * ldc + 4);
+
+    for (long long p = 0; p < w; p++) {
+        __m256d b0 = _mm256_loadu_pd(B + p * ldb);
+        __m256d b1 = _mm256_loadu_pd(B + p * ldb + 4);
+        __m256d a;
+
+        a = _mm256_broadcast_sd(A + p);
+        c00 = _mm256_fmadd_pd(a, b0, c00); c01 = _mm256_fmadd_pd(a, b1, c01);
+        a = _mm256_broadcast_sd(A + lda + p);
+        c10 = _mm256_fmadd_pd(a, b0, c10); c11 = _mm256_fmadd_pd(a, b1, c11);
+        a = _mm256_broadcast_sd(A + 2 * lda + p);
+        c20 = _mm256_fmadd_pd(a, b0, c20); c21 = _mm256_fmadd_pd(a, b1, c21);
+        a = _mm256_broadcast_sd(A + 3 * lda + p);
+        c30 = _mm256_fmadd_pd(a, b0, c30); c31 = _mm256_fmadd_pd(a, b1, c31);
+    }
+
+    _mm256_storeu_pd(C, c00);           _mm256_storeu_pd(C + 4, c01);
+    _mm256_storeu_pd(C + ldc, c10);     _mm256_storeu_pd(C + ldc + 4, c11);
+    _mm256_storeu_pd(C + 2 * ldc, c20); _mm256_storeu_pd(C + 2 * ldc + 4, c21);
+    _mm256_storeu_pd(C + 3 * ldc, c30); _mm256_storeu_pd(C + 3 * ldc + 4, c31);
+#else
+    double acc[GEMM_MR][GEMM_NR];
+
+    for (int r = 0; r < GEMM_MR; r++) {
+        for (int j = 0; j < GEMM_NR; j++) acc[r][j] = C[r * ldc + j];
+    }
+    for (long long p = 0; p < w; p++) {
+        const double *b = B + p * ldb;
+        for (int r = 0; r < GEMM_MR; r++) {
+            double a = A[r * lda + p];
+            for (int j = 0; j < GEMM_NR; j++) acc[r][j] += a * b[j];
+        }
+    }
+    for (int r = 0; r < GEMM_MR; r++) {
+        for (int j = 0; j < GEMM_NR; j++) C[r * ldc + j] = acc[r][j];
+    }
+#endif
+}
+
+/* Edge tiles (fewer than GEMM_MR rows or GEMM_NR columns). */
+static void edge_kernel(long long rows, long long cols, long long w, const double *A, long long lda,
+                        const double *B, long long ldb, double *C, long long ldc)
+{
+    for (long long r = 0; r < rows; r++) {
+        for (long long p = 0; p < w; p++) {
+            double a = A[r * lda + p];
+            const double *b = B + p * ldb;
+            for (long long j = 0; j < cols; j++) C[r * ldc + j] += a * b[j];
+        }
+    }
+}
+
+/*
+ * C[i0:i1, :] += Ap[i0:i1, 0:w] * Bp[0:w, 0:ncols] for one SUMMA panel
+ * (Ap row-major with leading dimension w, Bp and C with ncols). B is walked
+ * in GEMM_NC column blocks (w x GEMM_NC stays in L2) and the threads split
+ * each block's row strips.
+ */
+static void gemm_panel(long long i0, long long i1, long long w, const double *Ap,
+                       const double *Bp, double *C, long long ncols)
+{
+    #pragma omp parallel
+    for (long long jb = 0; jb < ncols; jb += GEMM_NC) {
+        long long je = (jb + GEMM_NC < ncols) ? jb + GEMM_NC : ncols;
+
+        #pragma omp for schedule(static)
+        for (long long i = i0; i < i1; i += GEMM_MR) {
+            long long mr = (i + GEMM_MR <= i1) ? GEMM_MR : i1 - i;
+            const double *a = Ap + i * w;
+            double *c = C + i * ncols;
+            long long j = jb;
+
+            if (mr == GEMM_MR) {
+                for (; j + GEMM_NR <= je; j += GEMM_NR) {
+                    micro_kernel(w, a, w, Bp + j, ncols, c + j, ncols);
+                }
+            }
+            if (j < je) {
+                edge_kernel(mr, je - j, w, a, w, Bp + j, ncols, c + j, ncols);
+            }
+        }
+    }
+}
+
+/* Command line options following <matrix_A_file> <matrix_B_file> <k>. */
+typedef struct {
+    int grid[2];              /* --grid, 0 x 0 = automatic */
+    long long panel;          /* SUMMA panel width nb */
+    int overlap;              /* double-buffered MPI_Ibcast panels */
+    int verify;
+} SummaOptions;
+
+static int parse_options(int argc, char **argv, SummaOptions *opt)
+{
+    memset(opt, 0, sizeof *opt);
+    opt->panel = 128;
+    opt->overlap = 1;
+
+    for (int i = 4; i < argc; i++) {
+        if (strncmp(argv[i], "--grid=", 7) == 0) {
+            if (sscanf(argv[i] + 7, "%dx%d", &opt->grid[0], &opt->grid[1]) != 2 ||
+                opt->grid[0] < 1 || opt->grid[1] < 1) return -1;
+        } else if (strncmp(argv[i], "--panel=", 8) == 0) {
+            opt->panel = atoll(argv[i] + 8);
+            if (opt->panel < 1 || opt->panel > 65536) return -1;
+        } else if (strcmp(argv[i], "--no-overlap") == 0) {
+            opt->overlap = 0;
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            opt->verify = 1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Local view of the 2D distribution on the Pr x Pc grid. */
+typedef struct {
+    int grid[2];
+    int coords[2];
+    MPI_Comm cart, row_comm, col_comm;   /* row_comm: my process row (varying column) */
+    long long *mc, *md;                  /* rows of A / C per process row */
+    long long *nc, *nd;                  /* columns of B / C per process column */
+    long long *kac, *kad;                /* inner dimension of A per process column */
+    long long *kbc, *kbd;                /* inner dimension of B per process row */
+} SummaGrid;
+
+/*
+ * Broadcast the SUMMA panel that starts at inner index kk into Abuf / Bbuf:
+ * the owning process column copies its A columns into Abuf and broadcasts
+ * them along each process row, the owning process row does the same for its
+ * B rows down each process column. With overlap the broadcasts are only
+ * posted (req), otherwise they complete here. Returns the panel width w:
+ * nb, cut at the block boundaries of both k partitions so that each panel
+ * has exactly one owner of either kind.
+ */
+static long long post_panel(const SummaOptions *opt, const SummaGrid *g, long long k, long long kk,
+                            const double *Aloc, const double *Bloc,
+                            double *Abuf, double *Bbuf, MPI_Request req[2])
+{
+    long long mloc = g->mc[g->coords[0]];
+    long long nloc = g->nc[g->coords[1]];
+    int ja = block_owner(g->kac, g->kad, g->grid[1], kk);
+    int ib = block_owner(g->kbc, g->kbd, g->grid[0], kk);
+
+    long long w = k - kk;
+    if (w > opt->panel) w = opt->panel;
+    if (w > g->kad[ja] + g->kac[ja] - kk) w = g->kad[ja] + g->kac[ja] - kk;
+    if (w > g->kbd[ib] + g->kbc[ib] - kk) w = g->kbd[ib] + g->kbc[ib] - kk;
+
+    if (g->coords[1] == ja) {
+        long long kaloc = g->kac[ja];
+        long long off = kk - g->kad[ja];
+        for (long long i = 0; i < mloc; i++) {
+            memcpy(Abuf + i * w, Aloc + i * kaloc + off, (size_t)w * sizeof(double));
+        }
+    }
+    if (g->coords[0] == ib) {
+        memcpy(Bbuf, Bloc + (kk - g->kbd[ib]) * nloc, (size_t)w * (size_t)nloc * sizeof(double));
+    }
+
+    if (opt->overlap) {
+        MPI_Ibcast(Abuf, (int)(mloc * w), MPI_DOUBLE, ja, g->row_comm, &req[0]);
+        MPI_Ibcast(Bbuf, (int)(w * nloc), MPI_DOUBLE, ib, g->col_comm, &req[1]);
+    } else {
+        MPI_Bcast(Abuf, (int)(mloc * w), MPI_DOUBLE, ja, g->row_comm);
+        MPI_Bcast(Bbuf, (int)(w * nloc), MPI_DOUBLE, ib, g->col_comm);
+        req[0] = req[1] = MPI_REQUEST_NULL;
+    }
+    return w;
+}
+
+/*
+ * SUMMA on the local blocks Aloc (m_i x ka_j), Bloc (kb_i x n_j), accumulating
+ * into Cloc (m_i x n_j).
+ *
+ * With overlap, panel s + 1 is posted into the second buffer pair before
+ * panel s is multiplied, and MPI_Testall is called every GEMM_MC rows so the
+ * nonblocking broadcast keeps progressing during the GEMM. times[] =
+ * { total, waiting for panels, GEMM }.
+ */
+static void summa(const SummaOptions *opt, const SummaGrid *g, long long k,
+                  const double *Aloc, const double *Bloc, double *Cloc, double times[3])
+{
+    long long mloc = g->mc[g->coords[0]];
+    long long nloc = g->nc[g->coords[1]];
+    long long nb = opt->panel;
+
+    double *Abuf[2], *Bbuf[2];
+    for (int b = 0; b < 2; b++) {
+        Abuf[b] = (double *)summa_alloc((size_t)mloc * (size_t)nb * sizeof(double));
+        Bbuf[b] = (double *)summa_alloc((size_t)nb * (size_t)nloc * sizeof(double));
+        if (!Abuf[b] || !Bbuf[b]) {
+            fprintf(stderr, "ERROR: out of memory for SUMMA panels\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    double t_wait = 0.0, t_gemm = 0.0;
+    double t_start = MPI_Wtime();
+
+    MPI_Request req[2][2];
+    long long w[2];
+    long long kk = 0;
+    int cur = 0;
+
+    double t = MPI_Wtime();
+    w[cur] = post_panel(opt, g, k, kk, Aloc, Bloc, Abuf[cur], Bbuf[cur], req[cur]);
+    kk += w[cur];
+    t_wait += MPI_Wtime() - t;
+
+    while (w[cur] > 0) {
+        int nxt = 1 - cur;
+
+        t = MPI_Wtime();
+        MPI_Waitall(2, req[cur], MPI_STATUSES_IGNORE);
+        w[nxt] = 0;
+        if (kk < k) {
+            w[nxt] = post_panel(opt, g, k, kk, Aloc, Bloc, Abuf[nxt], Bbuf[nxt], req[nxt]);
+            kk += w[nxt];
+        }
+        t_wait += MPI_Wtime() - t;
+
+        /* Multiply panel cur while panel nxt is in flight. */
+        for (long long i0 = 0; i0 < mloc; i0 += GEMM_MC) {
+            long long i1 = (i0 + GEMM_MC < mloc) ? i0 + GEMM_MC : mloc;
+
+            t = MPI_Wtime();
+            gemm_panel(i0, i1, w[cur], Abuf[cur], Bbuf[cur], Cloc, nloc);
+            t_gemm += MPI_Wtime() - t;
+
+            if (opt->overlap && w[nxt] > 0) {
+                int done;
+                MPI_Testall(2, req[nxt], &done, MPI_STATUSES_IGNORE);
+            }
+        }
+        cur = nxt;
+    }
+
+    times[0] = MPI_Wtime() - t_start;
+    times[1] = t_wait;
+    times[2] = t_gemm;
+
+    for (int b = 0; b < 2; b++) {
+        summa_free(Abuf[b]);
+        summa_free(Bbuf[b]);
+    }
+}
+
+/* Rank 0: naive fp64 C = A * B and the maximum deviation of the SUMMA result. */
+static void verify_report(const double *A, const double *B, const double *C,
+                          long long m, long long k, long long n)
+{
+    double max_abs = 0.0, max_ref = 0.0;
+
+    for (long long i = 0; i < m; i++) {
+        for (long long j = 0; j < n; j++) {
+            double ref = 0.0;
+            for (long long p = 0; p < k; p++) {
+                ref += A[(size_t)i * (size_t)k + (size_t)p] * B[(size_t)p * (size_t)n + (size_t)j];
+            }
+            double err = fabs(C[(size_t)i * (size_t)n + (size_t)j] - ref);
+            if (err > max_abs) max_abs = err;
+            if (fabs(ref) > max_ref) max_ref = fabs(ref);
+        }
+    }
+    printf("Verify: max |C - A*B| = %.3e, relative to max |A*B| = %.3e\n",
+           max_abs, (max_ref > 0.0) ? max_abs / max_ref : max_abs);
+}
+
+int main(int argc, char **argv)
+{
+    /* OpenMP threads compute between MPI calls; only the main thread calls MPI. */
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    if (provided < MPI_THREAD_FUNNELED) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "MPI library does not provide MPI_THREAD_FUNNELED");
+    }
+
+    SummaOptions opt;
+    long long k = (argc >= 4) ? atoll(argv[3]) : 0;
+    if (argc < 4 || k < 1 || parse_options(argc, argv, &opt) != 0) {
+        if (rank == 0) {
+            fprintf(stderr, "Usage: %s <matrix_A_file> <matrix_B_file> <k> "
+                            "[--grid=RxC] [--panel=NB] [--no-overlap] [--verify]\n"
+                            "  (A is m x k, B is k x n, both row-major)\n",
+                    argv[0]);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    const char *a_file = argv[1];
+    const char *b_file = argv[2];
+
+    /* dims[0] = m, dims[1] = n. */
+    long long dims[2] = { 0, 0 };
+
+    /* Rank 0 derives m and n from the entry counts. */
+    if (rank == 0) {
+        long long a_count = count_doubles_in_file(a_file);
+        long long b_count = count_doubles_in_file(b_file);
+        if (a_count <= 0 || a_count % k != 0) {
+            fprintf(stderr, "ERROR: matrix file '%s' does not hold a whole number of %lld-column rows\n",
+                    a_file, k);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (b_count <= 0 || b_count % k != 0) {
+            fprintf(stderr, "ERROR: matrix file '%s' does not hold %lld whole rows\n", b_file, k);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        dims[0] = a_count / k;
+        dims[1] = b_count / k;
+    }
+    MPI_Bcast(dims, 2, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    long long m = dims[0], n = dims[1];
+
+    /* Process grid: larger dimension along the larger of m and n. */
+    SummaGrid g;
+    memset(&g, 0, sizeof g);
+    if (opt.grid[0] > 0) {
+        if ((long long)opt.grid[0] * opt.grid[1] != p) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "--grid=RxC needs R * C == number of processes");
+        }
+        g.grid[0] = opt.grid[0];
+        g.grid[1] = opt.grid[1];
+    } else {
+        MPI_Dims_create(p, 2, g.grid);     /* grid[0] >= grid[1] */
+        if (n > m) {
+            int tmp = g.grid[0];
+            g.grid[0] = g.grid[1];
+            g.grid[1] = tmp;
+        }
+    }
+    int periods[2] = { 0, 0 };
+    int keep_row[2] = { 0, 1 }, keep_col[2] = { 1, 0 };
+    MPI_Cart_create(MPI_COMM_WORLD, 2, g.grid, periods, 0, &g.cart);
+    MPI_Cart_coords(g.cart, rank, 2, g.coords);
+    MPI_Cart_sub(g.cart, keep_row, &g.row_comm);
+    MPI_Cart_sub(g.cart, keep_col, &g.col_comm);
+
+    int Pr = g.grid[0], Pc = g.grid[1];
+    g.mc  = (long long *)malloc((size_t)Pr * sizeof(long long));
+    g.md  = (long long *)malloc((size_t)Pr * sizeof(long long));
+    g.kbc = (long long *)malloc((size_t)Pr * sizeof(long long));
+    g.kbd = (long long *)malloc((size_t)Pr * sizeof(long long));
+    g.nc  = (long long *)malloc((size_t)Pc * sizeof(long long));
+    g.nd  = (long long *)malloc((size_t)Pc * sizeof(long long));
+    g.kac = (long long *)malloc((size_t)Pc * sizeof(long long));
+    g.kad = (long long *)malloc((size_t)Pc * sizeof(long long));
+    if (!g.mc || !g.md || !g.kbc || !g.kbd || !g.nc || !g.nd || !g.kac || !g.kad) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for grid partitions");
+    }
+    block_partition(m, Pr, g.mc, g.md);
+    block_partition(k, Pr, g.kbc, g.kbd);
+    block_partition(n, Pc, g.nc, g.nd);
+    block_partition(k, Pc, g.kac, g.kad);
+
+    long long mloc = g.mc[g.coords[0]], nloc = g.nc[g.coords[1]];
+    long long kaloc = g.kac[g.coords[1]], kbloc = g.kbc[g.coords[0]];
+    if (mloc * opt.panel > INT_MAX || opt.panel * nloc > INT_MAX) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "panel larger than 2^31 elements, use a smaller --panel");
+    }
+
+    double *Aloc = (double *)summa_alloc((size_t)mloc * (size_t)kaloc * sizeof(double));
+    double *Bloc = (double *)summa_alloc((size_t)kbloc * (size_t)nloc * sizeof(double));
+    double *Cloc = (double *)summa_alloc((size_t)mloc * (size_t)nloc * sizeof(double));
+    if (!Aloc || !Bloc || !Cloc) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for local blocks");
+    }
+    memset(Cloc, 0, (size_t)mloc * (size_t)nloc * sizeof(double));
+
+    /* Per-rank block origins and shapes (root only) for A, B and C. */
+    double *Afull = NULL, *Bfull = NULL, *Cfull = NULL;
+    long long *blk = NULL;
+    if (rank == 0) {
+        Afull = load_matrix(a_file, (size_t)m, (size_t)k);
+        Bfull = load_matrix(b_file, (size_t)k, (size_t)n);
+        Cfull = (double *)summa_alloc((size_t)m * (size_t)n * sizeof(double));
+        if (!Afull || !Bfull) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read matrix files (format/size mismatch)");
+        }
+        blk = (long long *)malloc((size_t)p * 8 * sizeof(long long));
+        if (!Cfull || !blk) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for full C");
+        }
+        for (int r = 0; r < p; r++) {
+            int c[2];
+            MPI_Cart_coords(g.cart, r, 2, c);
+            blk[0 * p + r] = g.md[c[0]];  blk[1 * p + r] = g.mc[c[0]];    /* A, C rows */
+            blk[2 * p + r] = g.kad[c[1]]; blk[3 * p + r] = g.kac[c[1]];   /* A columns */
+            blk[4 * p + r] = g.kbd[c[0]]; blk[5 * p + r] = g.kbc[c[0]];   /* B rows */
+            blk[6 * p + r] = g.nd[c[1]];  blk[7 * p + r] = g.nc[c[1]];    /* B, C columns */
+        }
+    }
+    const long long *b0 = blk;
+    #define BLK(i) (b0 ? b0 + (size_t)(i) * (size_t)p : NULL)
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_dist = MPI_Wtime();
+    move_blocks(Afull, k, BLK(0), BLK(1), BLK(2), BLK(3), Aloc, mloc, kaloc, 0, 0, MPI_COMM_WORLD);
+    move_blocks(Bfull, n, BLK(4), BLK(5), BLK(6), BLK(7), Bloc, kbloc, nloc, 0, 0, MPI_COMM_WORLD);
+    t_dist = MPI_Wtime() - t_dist;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double times[3];
+    summa(&opt, &g, k, Aloc, Bloc, Cloc, times);
+
+    double t_gather = MPI_Wtime();
+    move_blocks(Cfull, n, BLK(0), BLK(1), BLK(6), BLK(7), Cloc, mloc, nloc, 1, 0, MPI_COMM_WORLD);
+    t_gather = MPI_Wtime() - t_gather;
+    #undef BLK
+
+    double t_max[3], t_min_gemm;
+    MPI_Reduce(times, t_max, 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&times[2], &t_min_gemm, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        write_result("Result.txt", Cfull, (size_t)m * (size_t)n);
+
+        double flops = 2.0 * (double)m * (double)n * (double)k;
+        int threads = 1;
+#ifdef _OPENMP
+        threads = omp_get_max_threads();
+#endif
+        printf("SUMMA C = A * B: m = %lld, n = %lld, k = %lld on a %d x %d grid, "
+               "%d thread(s) per rank, panel %lld, %s\n",
+               m, n, k, Pr, Pc, threads, opt.panel,
+               opt.overlap ? "double-buffered MPI_Ibcast" : "blocking MPI_Bcast");
+        printf("Multiply: %f s (%.2f GFLOP/s), local GEMM %f .. %f s per rank "
+               "(%.2f GFLOP/s per rank at the slowest), waiting for panels %f s\n",
+               t_max[0], flops / t_max[0] * 1e-9, t_min_gemm, t_max[2],
+               flops / p / t_max[2] * 1e-9, t_max[1]);
+        printf("Distribute A and B: %f s, gather C: %f s\n", t_dist, t_gather);
+
+        if (opt.verify) {
+            verify_report(Afull, Bfull, Cfull, m, k, n);
+        }
+    }
+
+    /* Cleanup */
+    summa_free(Aloc);
+    summa_free(Bloc);
+    summa_free(Cloc);
+    if (rank == 0) {
+        summa_free(Afull);
+        summa_free(Bfull);
+        summa_free(Cfull);
+        free(blk);
+    }
+    free(g.mc); free(g.md); free(g.kbc); free(g.kbd);
+    free(g.nc); free(g.nd); free(g.kac); free(g.kad);
+    MPI_Comm_free(&g.row_comm);
+    MPI_Comm_free(&g.col_comm);
+    MPI_Comm_free(&g.cart);
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,66 @@
+@echo off
+setlocal
+
+rem --------------------------------------------------------------------
+rem  Modify PATH so MinGW DLLs are used first (prevents popup issues)
+rem --------------------------------------------------------------------
+set "PATH=C:\msys64\mingw64\bin;%PATH%"
+
+rem --------------------------------------------------------------------
+rem  Define Microsoft MPI include & library folders (NO trailing '\')
+rem --------------------------------------------------------------------
+set "MSMPI_INC=C:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+set "MSMPI_LIB64=C:\Program Files (x86)\Microsoft SDKs\MPI\Lib\x64"
+
+rem --------------------------------------------------------------------
+rem  Move to directory where the script is located
+rem --------------------------------------------------------------------
+cd /d %~dp0
+
+rem --------------------------------------------------------------------
+rem  Input files and inner dimension
+rem  Usage: MPI_Matrix_Matrix_SUMMA.cmd [num_procs]
+rem  Matrix_A.txt is m x k, Matrix_B.txt is k x n (row-major), K = k.
+rem --------------------------------------------------------------------
+set "A_FILE=Matrix_A.txt"
+set "B_FILE=Matrix_B.txt"
+set K=6
+
+rem Extra program options, e.g. --grid=2x2, --panel=64, --no-overlap, --verify
+set "OPTIONS=--verify"
+
+rem Optional: number of MPI processes (default = 4)
+if "%~1"=="" (
+    set NP=4
+) else (
+    set NP=%~1
+)
+
+rem --------------------------------------------------------------------
+rem  Build the MPI SUMMA matrix-matrix program
+rem  -march=native enables the AVX2/FMA micro-kernel of the local GEMM.
+rem  -fopenmp enables the threaded GEMM (threads per rank = OMP_NUM_THREADS).
+rem --------------------------------------------------------------------
+echo Building MPI_Matrix_Matrix_SUMMA.c ...
+gcc MPI_Matrix_Matrix_SUMMA.c ^
+  -O3 -fopenmp -march=native ^
+  -I"%MSMPI_INC%" ^
+  -L"%MSMPI_LIB64%" ^
+  -lmsmpi ^
+  -o MPI_Matrix_Matrix_SUMMA.exe
+
+if %errorlevel% neq 0 (
+    echo [ERROR] Compilation failed!
+    exit /b 1
+)
+
+echo Build completed successfully.
+
+rem --------------------------------------------------------------------
+rem  Run the MPI program
+rem --------------------------------------------------------------------
+echo Running: mpiexec -n %NP% MPI_Matrix_Matrix_SUMMA.exe %A_FILE% %B_FILE% %K% %OPTIONS%
+echo --------------------------------------------------------------
+call mpiexec -n %NP% MPI_Matrix_Matrix_SUMMA.exe "%A_FILE%" "%B_FILE%" %K% %OPTIONS%
+
+endlocal
@@ -39,6 +39,9 @@ rem --------------------------------------------------------------------
 set "VEC_FILE=Vector.txt"
 set "MAT_FILE=Matrix.txt"
 
+rem Pipeline depth: each rank's rows arrive in CHUNKS non-blocking scatters
+set CHUNKS=4
+
 rem Optional: number of MPI processes (default = 4)
 if "%~3"=="" (
     set NP=4
@@ -48,9 +51,11 @@ if "%~3"=="" (
 
 rem --------------------------------------------------------------------
 rem  Build the MPI matrix-vector program
+rem  -O3 inlines the DenseOperator row visitor into the matvec loop.
 rem --------------------------------------------------------------------
 echo Building MPI_Matrix_Vector.cpp ...
 g++ MPI_Matrix_Vector.cpp ^
+  -O3 ^
   -I"%MSMPI_INC%" ^
   -L"%MSMPI_LIB64%" ^
   -lmsmpi ^
@@ -66,8 +71,8 @@ echo Build completed successfully.
 rem --------------------------------------------------------------------
 rem  Run the MPI program
 rem --------------------------------------------------------------------
-echo Running: mpiexec -n %NP% MPI_Matrix_Vector.exe %VEC_FILE% %MAT_FILE%
+echo Running: mpiexec -n %NP% MPI_Matrix_Vector.exe %VEC_FILE% %MAT_FILE% %CHUNKS%
 echo --------------------------------------------------------------
-call mpiexec -n %NP% MPI_Matrix_Vector.exe "%VEC_FILE%" "%MAT_FILE%"
+call mpiexec -n %NP% MPI_Matrix_Vector.exe "%VEC_FILE%" "%MAT_FILE%" %CHUNKS%
 
 endlocal
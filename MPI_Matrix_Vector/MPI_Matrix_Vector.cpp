@@ -1,112 +1,10 @@
-#include <stdio.h>   // For FILE*, fopen, fscanf, fprintf, fclose
+#include <stdio.h>   // For fprintf, printf
+#include <stddef.h>  // For size_t
+#include <stdlib.h>  // For atoi
+#include <limits.h>  // For INT_MAX
 #include <mpi.h>     // MPI library
 
-// -----------------------------------------------------------------------------
-// returnSize
-// -----------------------------------------------------------------------------
-// Reads a text file with one double per entry and returns how many numbers
-// are stored in that file.
-//
-// Parameters:
-//   fname - path to the text file with double values
-//
-// Returns:
-//   Number of doubles stored in the file (dimension of the vector).
-// -----------------------------------------------------------------------------
-int returnSize(char* fname)
-{
-    FILE* f = fopen(fname, "r");
-    int dim = 0;
-    double tmp;
-
-    // Read doubles one by one until EOF and count them
-    while (fscanf(f, "%lf", &tmp) != EOF)
-        dim++;
-
-    fclose(f);
-    return dim;
-}
-
-// -----------------------------------------------------------------------------
-// loadVec
-// -----------------------------------------------------------------------------
-// Allocates and loads a vector (1D array) of size n from a text file.
-//
-// Assumes the file has at least n double values separated by whitespace.
-//
-// Parameters:
-//   fname - path to the file with vector elements
-//   n     - expected number of elements
-//
-// Returns:
-//   Pointer to a dynamically allocated array of n doubles.
-//   Caller is responsible for delete[].
-// -----------------------------------------------------------------------------
-double* loadVec(char* fname, int n)
-{
-    FILE* f = fopen(fname, "r");
-    double* res = new double[n]; // allocate vector
-    double* it = res;
-
-    // Read values into consecutive elements of res
-    while (fscanf(f, "%lf", it++) != EOF)
-        /* empty body */;
-
-    fclose(f);
-    return res;
-}
-
-// -----------------------------------------------------------------------------
-// loadMat
-// -----------------------------------------------------------------------------
-// Allocates and loads a matrix of size n x n from a text file.
-//
-// The matrix is stored in a 1D array in row-major order:
-//
-//   res[ i * n + j ] = element at row i, column j
-//
-// Assumes the file has at least n*n double values.
-//
-// Parameters:
-//   fname - path to the file with matrix elements
-//   n     - dimension of the matrix (n x n)
-//
-// Returns:
-//   Pointer to a dynamically allocated array of n*n doubles.
-//   Caller is responsible for delete[].
-// -----------------------------------------------------------------------------
-double* loadMat(char* fname, int n)
-{
-    FILE* f = fopen(fname, "r");
-    double* res = new double[n * n]; // allocate matrix as 1D array
-    double* it = res;
-
-    // Read n*n values into res
-    while (fscanf(f, "%lf", it++) != EOF)
-        /* empty body */;
-
-    fclose(f);
-    return res;
-}
-
-// -----------------------------------------------------------------------------
-// logRes
-// -----------------------------------------------------------------------------
-// Writes the result vector to a text file, one line with all values
-// separated by spaces.
-//
-// Parameters:
-//   fname - output file name
-//   res   - pointer to result vector
-//   n     - length of result vector
-// -----------------------------------------------------------------------------
-void logRes(const char* fname, double* res, int n)
-{
-    FILE* f = fopen(fname, "w");
-    for (int i = 0; i != n; ++i)
-        fprintf(f, "%lf ", res[i]);
-    fclose(f);
-}
+#include "../MPI_Common/MPI_Operator.h"  // File helpers, row datatype, DenseOperator
 
 // -----------------------------------------------------------------------------
 // main
@@ -116,21 +14,40 @@ void logRes(const char* fname, double* res, int n)
 // Input arguments (command line):
 //   argv[1] - path to vector file (vfname)
 //   argv[2] - path to matrix file (mfname)
+//   argv[3] - optional number of pipeline chunks per rank (default 4)
 //
 // Vector length = dim
-// Matrix size   = dim x dim (stored in row-major order in the file)
+// Matrix size   = rows x dim (stored in row-major order in the file;
+//                 rows = number of matrix entries / dim)
+//
+// The work is divided by rows of the matrix across MPI processes: rank k
+// gets rows / csize rows, plus one if k < rows % csize (uneven counts go
+// through MPI_Scatterv / MPI_Gatherv, so any rows and csize work). The
+// matrix file must hold a whole number of rows of dim values.
 //
-// The work is divided by rows of the matrix across MPI processes.
-// It assumes that dim is divisible by number of processes (csize).
+// The local product is applyRows() over a DenseOperator holding this rank's
+// rows (MPI_Common/MPI_Operator.h), the same kernel that
+// MPI_Matrix_Vector_Operator instantiates for its generated operators.
+//
+// Sizes and indices are 64-bit. Transfers are counted in rows of a derived
+// "row" datatype (dim contiguous doubles), so the MPI int counts never hold
+// element counts and multi-GB matrices scatter without manual chunking.
 //
 // Steps:
-//   1. Rank 0 reads the vector file to determine dim (vector length).
-//   2. Broadcast dim to all ranks.
-//   3. Rank 0 loads the full vector; broadcast it to all ranks.
-//   4. Rank 0 loads the full matrix; scatter pieces of it to each rank.
-//   5. Each rank computes its partial result (subset of rows).
+//   1. Rank 0 reads the vector file to determine dim (vector length) and the
+//      matrix file to determine rows.
+//   2. Broadcast dim and rows to all ranks.
+//   3. Rank 0 loads the full vector; start a non-blocking broadcast of it.
+//   4. Rank 0 loads the full matrix; start one non-blocking scatter per
+//      chunk of each rank's rows.
+//   5. Each rank computes its partial result chunk by chunk, as soon as the
+//      chunk (and, for the first one, the vector) has arrived, so later
+//      chunks are still in flight while earlier ones are computed. Between
+//      chunks the outstanding transfers are polled with MPI_Test, so the
+//      communication span (start to last completion) is measured inside the
+//      pipeline and hidden communication = span - time waiting for data.
 //   6. Gather all partial results to rank 0.
-//   7. Rank 0 writes the full result vector to "res.txt".
+//   7. Rank 0 writes the full result vector to "Result.txt".
 // -----------------------------------------------------------------------------
 int main(int argc, char* argv[])
 {
@@ -142,96 +59,266 @@ int main(int argc, char* argv[])
     MPI_Comm_size(MPI_COMM_WORLD, &csize);
     MPI_Comm_rank(MPI_COMM_WORLD, &prank);
 
-    // Command line arguments: vector file and matrix file
+    if (argc < 3)
+    {
+        if (prank == 0)
+            fprintf(stderr, "Usage: %s <vector_file> <matrix_file> [chunks]\n", argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Command line arguments: vector file, matrix file, pipeline depth
     char* vfname = argv[1];
     char* mfname = argv[2];
+    int chunks = (argc > 3) ? atoi(argv[3]) : 4;
+    if (chunks < 1)
+        chunks = 1;
 
-    int dim;        // dimension of the vector/matrix
+    long long dims[2]; // dims[0] = rows of the matrix, dims[1] = dim (vector length)
     double* mat;    // local chunk of matrix
     double* vec;    // full vector (every process has a copy)
     double* tmat;   // full matrix (only rank 0 has it)
     double* lres;   // local result (subset of rows)
-    double* res;    // final result (only rank 0 has it)
+    double* res = NULL;  // final result (only rank 0 has it)
 
-    // Rank 0 reads vector file to determine dimension
+    // Rank 0 reads vector file to determine dimension, and the matrix
+    // file to determine the number of rows; inconsistent files abort.
+    // Row counts and displacements are MPI ints, hence the INT_MAX limit.
     if (prank == 0)
-        dim = returnSize(vfname);
+    {
+        dims[1] = returnSize(vfname);
+        long long entries = returnSize(mfname);
+        if (dims[1] <= 0)
+        {
+            fprintf(stderr, "ERROR: vector file '%s' is missing or empty\n", vfname);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (entries < 0)
+        {
+            fprintf(stderr, "ERROR: cannot open matrix file '%s'\n", mfname);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (entries == 0 || entries % dims[1] != 0 || entries / dims[1] > INT_MAX)
+        {
+            fprintf(stderr, "ERROR: matrix file '%s' holds %lld values, not a whole number "
+                    "(1..INT_MAX) of rows of %lld\n", mfname, entries, dims[1]);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        dims[0] = entries / dims[1];
+    }
+
+    // Broadcast the dimensions to all processes
+    MPI_Bcast(dims, 2, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
 
-    // Broadcast the dimension to all processes
-    MPI_Bcast(&dim, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    size_t rows = (size_t)dims[0];
+    size_t dim  = (size_t)dims[1];
+
+    // One matrix row (and the whole vector) is 'dim' contiguous doubles
+    MPI_Datatype rowType;
+    makeRowType(dims[1], &rowType);
 
     // Load or allocate vector:
     // Rank 0 reads full vector from file; others just allocate memory.
+    // All matrix/vector buffers come from allocDoubles (64-byte / huge-page
+    // aligned, see MPI_Operator.h). There are no OpenMP threads here, so the
+    // first touch is simply by the rank's only thread.
     if (prank == 0)
-        vec = loadVec(vfname, dim);
+        vec = loadDoubles(vfname, dim);
     else
-        vec = new double[dim];
+        vec = allocDoubles(dim);
+    if (!vec)
+    {
+        fprintf(stderr, "ERROR: failed to read vector file '%s'\n", vfname);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
 
-    // Broadcast full vector to all ranks
-    MPI_Bcast(vec, dim, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    // Start broadcasting the full vector (one "row" worth of doubles); it is
+    // only waited for right before the first chunk is computed
+    MPI_Request vecReq;
+    MPI_Ibcast(vec, 1, rowType, 0, MPI_COMM_WORLD, &vecReq);
 
-    // Rank 0 loads full matrix (dim x dim)
+    // Rank 0 loads full matrix (rows x dim)
+    tmat = NULL;
     if (prank == 0)
-        tmat = loadMat(mfname, dim);
-
-    // Number of matrix elements per process:
-    // We are dividing the matrix by rows, so each process gets
-    // (dim / csize) rows, each with dim columns.
-    // Total elements per process = dim * (dim / csize)
-    int msize = dim * dim / csize;
-    mat = new double[msize];
-
-    // Scatter parts of the matrix from rank 0 to all ranks:
-    //   tmat (root buffer) -> mat (local buffer on each process)
-    MPI_Scatter(
-        tmat, msize, MPI_DOUBLE,   // send buffer (root only)
-        mat,  msize, MPI_DOUBLE,   // receive buffer (all)
-        0, MPI_COMM_WORLD
-    );
+    {
+        tmat = loadDoubles(mfname, rows * dim);
+        if (!tmat)
+        {
+            fprintf(stderr, "ERROR: failed to read matrix file '%s'\n", mfname);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+
+    // Uneven row distribution: rank k owns 'counts[k]' rows starting at
+    // global row 'displs[k]' (rows / csize each, the first rows % csize
+    // ranks one more). This rank computes 'to' rows of the result.
+    // Total elements per process = to * dim, computed in size_t.
+    int* counts = new int[csize];
+    int* displs = new int[csize];
+    for (int k = 0; k != csize; ++k)
+    {
+        counts[k] = (int)(rows / csize) + (k < (int)(rows % csize) ? 1 : 0);
+        displs[k] = (k == 0) ? 0 : displs[k - 1] + counts[k - 1];
+    }
+    int to = counts[prank];
+    size_t msize = (size_t)to * dim;
+    mat  = allocDoubles(msize);
+    lres = allocDoubles((size_t)to);
+    if (!mat || !lres)
+    {
+        fprintf(stderr, "ERROR: rank %d out of memory for %d matrix rows\n", prank, to);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Split each rank's rows into chunks; on this rank chunk c covers local
+    // rows [cfirst[c], cfirst[c] + crows[c]). Chunk c of every rank is
+    // scattered by one MPI_Iscatterv; counts and displacements are in rows,
+    // so they cannot overflow an int. The arrays must live until the
+    // requests finish.
+    int* crows  = new int[chunks];
+    int* cfirst = new int[chunks];
+    int* scount = new int[(size_t)chunks * csize];
+    int* sdispl = new int[(size_t)chunks * csize];
+    for (int k = 0; k != csize; ++k)
+    {
+        int first = 0;
+        for (int c = 0; c != chunks; ++c)
+        {
+            int n = counts[k] / chunks + (c < counts[k] % chunks ? 1 : 0);
+            scount[(size_t)c * csize + k] = n;
+            sdispl[(size_t)c * csize + k] = displs[k] + first;
+            if (k == prank)
+            {
+                crows[c]  = n;
+                cfirst[c] = first;
+            }
+            first += n;
+        }
+    }
+
+    // matReq[c] scatters chunk c; matReq[chunks] is the vector broadcast
+    MPI_Request* matReq = new MPI_Request[chunks + 1];
+    bool* done = new bool[chunks + 1]();
+    matReq[chunks] = vecReq;
+
+    // Line up behind rank 0's matrix loading so it is not counted as waiting
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
 
-    // Each process will compute "to" rows of the result
-    int to = dim / csize;
-    lres = new double[to];
+    for (int c = 0; c != chunks; ++c)
+    {
+        MPI_Iscatterv(
+            tmat, &scount[(size_t)c * csize], &sdispl[(size_t)c * csize], rowType,   // send (root only)
+            mat + (size_t)cfirst[c] * dim, crows[c], rowType,    // receive chunk c
+            0, MPI_COMM_WORLD, &matReq[c]
+        );
+    }
 
-    // Local matrix-vector multiplication:
-    // Here 'mat' contains 'to' consecutive rows of the global matrix.
-    // For each local row i, compute:
+    // Local matrix-vector multiplication, chunk by chunk:
+    // Here 'mat' contains 'to' consecutive rows of the global matrix, starting
+    // at global row displs[prank] (the vector is waited for even if this rank
+    // has no rows). For each local row i, applyRows computes:
     //   lres[i] = sum_j mat[i * dim + j] * vec[j]
-    for (int i = 0; i != to; ++i)
+    DenseOperator A = { rows, dim, (size_t)displs[prank], mat };
+    double waitTime = 0;
+    double lastDone = start;   // latest time a transfer was seen to finish
+
+    // A completion is only seen at the next wait or poll, so the span is
+    // rounded up by at most one chunk of compute.
+    auto waitFor = [&](int i)
+    {
+        if (done[i])
+            return;
+        MPI_Wait(&matReq[i], MPI_STATUS_IGNORE);
+        done[i] = true;
+        lastDone = MPI_Wtime();
+    };
+    auto poll = [&]()
     {
-        double s = 0;
-        for (int j = 0; j != dim; ++j)
-            s += mat[i * dim + j] * vec[j];
-        lres[i] = s;
+        for (int i = 0; i != chunks + 1; ++i)
+        {
+            int flag = 0;
+            if (!done[i])
+                MPI_Test(&matReq[i], &flag, MPI_STATUS_IGNORE);
+            if (flag)
+            {
+                done[i] = true;
+                lastDone = MPI_Wtime();
+            }
+        }
+    };
+
+    for (int c = 0; c != chunks; ++c)
+    {
+        double w = MPI_Wtime();
+        waitFor(c);
+        if (c == 0)
+            waitFor(chunks);
+        waitTime += MPI_Wtime() - w;
+
+        size_t first = A.rowBegin + (size_t)cfirst[c];
+        applyRows(A, first, first + (size_t)crows[c], vec, lres + cfirst[c]);
+        poll();
     }
 
+    // Pipeline, communication span and time blocked on communication
+    // (max over ranks); hidden communication (span - wait) is the least
+    // any rank achieved.
+    double span = lastDone - start;
+    double hidden = (span > waitTime) ? span - waitTime : 0.0;
+    double times[3] = { MPI_Wtime() - start, span, waitTime };
+    double maxTimes[3];
+    double minHidden;
+    MPI_Reduce(times, maxTimes, 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&hidden, &minHidden, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+
     // Rank 0 allocates space for the complete result vector
     if (prank == 0)
-        res = new double[dim];
+    {
+        res = allocDoubles(rows);
+        if (!res)
+        {
+            fprintf(stderr, "ERROR: out of memory for the result vector\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
 
-    // Gather partial results from all processes into res on rank 0
-    MPI_Gather(
-        lres, to, MPI_DOUBLE,   // send buffer on each rank
-        res,  to, MPI_DOUBLE,   // recv buffer on root
+    // Gather the uneven partial results from all processes into res on rank 0
+    MPI_Gatherv(
+        lres, to, MPI_DOUBLE,                   // send buffer on each rank
+        res,  counts, displs, MPI_DOUBLE,       // recv buffer on root
         0, MPI_COMM_WORLD
     );
 
     // Rank 0 logs the final result to a file
     if (prank == 0)
     {
-        logRes("Result.txt", res, dim);
+        logRes("Result.txt", res, rows);
+        printf("Pipeline (%d chunks): %f s, communication span %f s, %f s waiting for data "
+               "(max over ranks); hidden communication at least %f s on every rank\n",
+               chunks, maxTimes[0], maxTimes[1], maxTimes[2], minHidden);
     }
 
+    MPI_Type_free(&rowType);
+
     // Clean-up: free dynamically allocated memory
     if (prank == 0)
     {
-        delete[] tmat;
-        delete[] res;
+        freeDoubles(tmat);
+        freeDoubles(res);
     }
 
-    delete[] vec;
-    delete[] mat;
-    delete[] lres;
+    freeDoubles(vec);
+    freeDoubles(mat);
+    freeDoubles(lres);
+    delete[] counts;
+    delete[] displs;
+    delete[] crows;
+    delete[] cfirst;
+    delete[] sdispl;
+    delete[] scount;
+    delete[] matReq;
+    delete[] done;
 
     // Finalize MPI
     MPI_Finalize();
@@ -0,0 +1,845 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <mpi.h>
+
+/*
+ * Banded matrix-vector multiplication: y = A * x
+ *
+ * A is an n x n band matrix with kl sub-diagonals and ku super-diagonals
+ * (tridiagonal: kl = ku = 1). Only the w = kl + ku + 1 diagonals are stored,
+ * so memory and work are O(n * w) instead of O(n^2).
+ *
+ * Key features:
+ *  - LAPACK band layout on input (the AB array used by dgbmv/dgbsv).
+ *  - Uneven row-block distribution with MPI_Scatterv / MPI_Gatherv, as in
+ *    MPI_Matrix_Vector_General.
+ *  - Each rank receives only the x window its rows touch
+ *    (x[offset - kl .. offset + rows - 1 + ku]), not the full vector.
+ *  - Local block is stored diagonal-major, so the kernel streams each diagonal
+ *    with unit stride (vectorizes with -O3) and has a dedicated tridiagonal path.
+ *  - Optional relaxation solve of A u = x (Jacobi or multicolor Gauss-Seidel)
+ *    on the resident band blocks: after each sweep (each color) only the
+ *    kl / ku boundary entries travel to the neighbouring ranks (see relax_band).
+ *  - Optional communication-avoiding matrix powers x, A x, ..., A^k x: one
+ *    halo exchange of depth k * kl / k * ku, then k local products that
+ *    recompute the neighbours' boundary rows (see matrix_powers_ca), timed
+ *    against k ordinary exchange + product steps.
+ *
+ * Input format (whitespace separated doubles):
+ *  - Vector file: n doubles
+ *  - Band file:   (kl + ku + 1) * n doubles, LAPACK AB in column-major order:
+ *                   AB[(ku + i - j) + j * (kl + ku + 1)] = A(i, j)
+ *                 i.e. column j of A contributes its kl + ku + 1 band entries,
+ *                 top to bottom. Entries outside the matrix are ignored.
+ *
+ * Usage:
+ *   mpiexec -n <p> MPI_Matrix_Vector_Banded <vector_file> <band_file> <kl> <ku>
+ *                  [jacobi|mcgs [max_sweeps [check_every [tol]]] | powers <k>]
+ *
+ *   The optional method solves A u = x after the product, for at most
+ *   max_sweeps sweeps (default 1000), forming the residual (one
+ *   MPI_Allreduce) every check_every sweeps (default 10) and stopping once
+ *   ||x - A u|| <= tol * ||x|| (default 1e-10). mcgs colors row i with
+ *   i mod (max(kl, ku) + 1), red-black for a tridiagonal A. Every rank needs
+ *   at least max(kl, ku) rows, so the halos come from the direct neighbours
+ *   only.
+ *
+ *   "powers k" computes A^s x for s = 0 .. k on the resident blocks. The
+ *   band rows of the (k - 1) * kl / (k - 1) * ku ghost region are fetched
+ *   from the neighbours once at setup; every rank needs k * max(kl, ku) rows.
+ *
+ * Output (rank 0):
+ *   Result.txt containing n doubles (space-separated)
+ *   Solution.txt containing u (relaxation only)
+ *   Powers.txt containing A^s x, one line of n doubles per s = 0 .. k (powers only)
+ */
+
+/* Rows processed per diagonal sweep; keeps the y block resident in L1. */
+#define BAND_ROW_BLOCK 512
+
+static void die_rank0_abort(MPI_Comm comm, int rank, const char *msg)
+{
+    if (rank == 0) {
+        fprintf(stderr, "ERROR: %s\n", msg);
+    }
+    MPI_Abort(comm, 1);
+}
+
+/* Parse a non-negative int argument; returns -1 on error. */
+static int parse_nonneg_int(const char *s)
+{
+    char *end = NULL;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || v < 0 || v > 0x7fffffffL) return -1;
+    return (int)v;
+}
+
+/* Count how many doubles are present in a file (vector size). */
+static long long count_doubles_in_file(const char *fname)
+{
+    FILE *f = fopen(fname, "r");
+    if (!f) return -1;
+
+    long long count = 0;
+    double tmp;
+    while (fscanf(f, "%lf", &tmp) == 1) {
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+static double *load_doubles(const char *fname, size_t count)
+{
+    FILE *f = fopen(fname, "r");
+    if (!f) return NULL;
+
+    double *v = (double *)malloc(count * sizeof(double));
+    if (!v) { fclose(f); return NULL; }
+
+    for (size_t i = 0; i < count; i++) {
+        if (fscanf(f, "%lf", &v[i]) != 1) {
+            free(v);
+            fclose(f);
+            return NULL;
+        }
+    }
+    fclose(f);
+    return v;
+}
+
+static void write_result(const char *fname, const double *y, int n)
+{
+    FILE *f = fopen(fname, "w");
+    if (!f) return;
+
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "%lf%s", y[i], (i + 1 == n) ? "" : " ");
+    }
+    fprintf(f, "\n");
+    fclose(f);
+}
+
+/*
+ * Repack rows [row_off, row_off + rows) of a LAPACK AB array into
+ * diagonal-major order: D[d * rows + (i - row_off)] = A(i, i - kl + d).
+ * Positions that fall outside the matrix are zero.
+ */
+static void pack_block_diagonal_major(const double *AB, int n, int kl, int ku,
+                                      int row_off, int rows, double *D)
+{
+    int w = kl + ku + 1;
+
+    for (int d = 0; d < w; d++) {
+        for (int li = 0; li < rows; li++) {
+            int i = row_off + li;
+            int j = i - kl + d;
+            D[(size_t)d * rows + li] =
+                (j >= 0 && j < n) ? AB[(size_t)(ku + kl - d) + (size_t)j * w] : 0.0;
+        }
+    }
+}
+
+/*
+ * The kernels below read diagonal d of the block at D + d * ld, so a row
+ * range of a larger diagonal-major block (ld = its row count) can be passed
+ * as D + first_row with rows < ld (see the matrix powers kernel).
+ */
+
+/* One output row of the band product (used for the tridiagonal boundary rows). */
+static double band_row(const double *D, int ld, int w, int kl, int n,
+                       int row_off, int li, const double *xwin, int xlo)
+{
+    int i = row_off + li;
+    double sum = 0.0;
+
+    for (int d = 0; d < w; d++) {
+        int j = i - kl + d;
+        if (j >= 0 && j < n) {
+            sum += D[(size_t)d * ld + li] * xwin[j - xlo];
+        }
+    }
+    return sum;
+}
+
+/*
+ * General band kernel. For each block of rows, sweep the diagonals one at a
+ * time: y[i] += D_d[i] * x[i - kl + d]. Both operands have unit stride, so the
+ * inner loop is a plain fused multiply-add stream.
+ */
+static void band_matvec(const double *restrict D, int ld, int rows, int kl, int ku,
+                        int n, int row_off, const double *restrict xwin, int xlo,
+                        double *restrict y)
+{
+    int w = kl + ku + 1;
+
+    for (int b0 = 0; b0 < rows; b0 += BAND_ROW_BLOCK) {
+        int b1 = (b0 + BAND_ROW_BLOCK < rows) ? b0 + BAND_ROW_BLOCK : rows;
+
+        for (int li = b0; li < b1; li++) y[li] = 0.0;
+
+        for (int d = 0; d < w; d++) {
+            /* Clip rows whose column i - kl + d lies outside [0, n). */
+            int lo = kl - d - row_off;
+            int hi = n - row_off + kl - d;
+            if (lo < b0) lo = b0;
+            if (hi > b1) hi = b1;
+
+            const double *restrict dv = D + (size_t)d * ld;
+            int shift = row_off - kl + d - xlo;
+
+            for (int li = lo; li < hi; li++) {
+                y[li] += dv[li] * xwin[li + shift];
+            }
+        }
+    }
+}
+
+/*
+ * Tridiagonal kernel (kl = ku = 1): a single pass over the three diagonals.
+ * The first and last global rows miss one neighbour and are computed separately.
+ */
+static void tridiag_matvec(const double *restrict D, int ld, int rows, int n, int row_off,
+                           const double *restrict xwin, int xlo, double *restrict y)
+{
+    const double *restrict lower = D;
+    const double *restrict diag  = D + ld;
+    const double *restrict upper = D + 2 * (size_t)ld;
+
+    int lo = (row_off == 0) ? 1 : 0;
+    int hi = (row_off + rows == n) ? rows - 1 : rows;
+    int shift = row_off - xlo;
+
+    for (int li = lo; li < hi; li++) {
+        y[li] = lower[li] * xwin[li + shift - 1]
+              + diag[li]  * xwin[li + shift]
+              + upper[li] * xwin[li + shift + 1];
+    }
+
+    if (lo == 1) {
+        y[0] = band_row(D, ld, 3, 1, n, row_off, 0, xwin, xlo);
+    }
+    if (hi == rows - 1 && rows - 1 >= lo) {
+        y[rows - 1] = band_row(D, ld, 3, 1, n, row_off, rows - 1, xwin, xlo);
+    }
+}
+
+/* Band product with the tridiagonal fast path when kl = ku = 1. */
+static void band_product(const double *D, int ld, int rows, int kl, int ku, int n, int row_off,
+                         const double *xwin, int xlo, double *y)
+{
+    if (kl == 1 && ku == 1) {
+        tridiag_matvec(D, ld, rows, n, row_off, xwin, xlo, y);
+    } else {
+        band_matvec(D, ld, rows, kl, ku, n, row_off, xwin, xlo, y);
+    }
+}
+
+/*
+ * Refresh the halos of the local iterate window uwin = u[xlo, xhi): my last
+ * kl rows become the lower halo of rank + 1, my first ku rows the upper halo
+ * of rank - 1 (hl / hu = my own halo lengths, 0 at the ends).
+ */
+static void exchange_halo(double *uwin, int rows, int kl, int ku, int hl, int hu,
+                          int rank, int p, MPI_Comm comm)
+{
+    int down = (rank > 0) ? rank - 1 : MPI_PROC_NULL;
+    int up   = (rank < p - 1) ? rank + 1 : MPI_PROC_NULL;
+    double *own = uwin + hl;
+
+    MPI_Sendrecv(own + rows - kl, (up != MPI_PROC_NULL) ? kl : 0, MPI_DOUBLE, up, 0,
+                 uwin, hl, MPI_DOUBLE, down, 0, comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(own, (down != MPI_PROC_NULL) ? ku : 0, MPI_DOUBLE, down, 1,
+                 own + rows, hu, MPI_DOUBLE, up, 1, comm, MPI_STATUS_IGNORE);
+}
+
+/*
+ * One relaxation pass over the local rows with i mod colors == color (all
+ * rows when color < 0), from the current window uwin:
+ *   unew_i = (b_i - sum_{j != i} a_ij u_j) / a_ii
+ * Rows of the other colors keep their value. With colors = max(kl, ku) + 1
+ * two rows of one color are more than the bandwidth apart, so they do not
+ * couple and the pass is an exact Gauss-Seidel step for that color. Updates
+ * go to unew first, so the result does not depend on the row order or on the
+ * number of ranks.
+ */
+static void relax_band(const double *D, int rows, int kl, int ku, int n, int row_off,
+                       const double *b, const double *uwin, int xlo, double *unew,
+                       int colors, int color)
+{
+    int w = kl + ku + 1;
+
+    for (int li = 0; li < rows; li++) {
+        int i = row_off + li;
+        if (color >= 0 && i % colors != color) {
+            unew[li] = uwin[i - xlo];
+            continue;
+        }
+        double sum = 0.0;
+        for (int d = 0; d < w; d++) {
+            int j = i - kl + d;
+            if (d != kl && j >= 0 && j < n) {
+                sum += D[(size_t)d * rows + li] * uwin[j - xlo];
+            }
+        }
+        unew[li] = (b[li] - sum) / D[(size_t)kl * rows + li];
+    }
+}
+
+/*
+ * Ghost band rows for the matrix powers kernel: Dext (diagonal-major, erows
+ * rows starting at global row eoff) receives my own block plus the last
+ * gl rows of rank - 1 and the first gu rows of rank + 1. A row range of the
+ * diagonal-major Dlocal is a strided vector of w pieces, so each side is one
+ * MPI_Sendrecv with vector datatypes and no packing.
+ */
+static void exchange_ghost_rows(const double *Dlocal, int rows, int w, int gl, int gu,
+                                double *Dext, int erows, int rank, int p, MPI_Comm comm)
+{
+    int down = (rank > 0) ? rank - 1 : MPI_PROC_NULL;
+    int up   = (rank < p - 1) ? rank + 1 : MPI_PROC_NULL;
+    int own  = (down != MPI_PROC_NULL) ? gl : 0;
+    int send_up = (up != MPI_PROC_NULL) ? gl : 0;
+    int send_down = (down != MPI_PROC_NULL) ? gu : 0;
+    int recv_up = (up != MPI_PROC_NULL) ? gu : 0;
+    MPI_Datatype s_up, r_down, s_down, r_up;
+
+    for (int d = 0; d < w; d++) {
+        memcpy(Dext + (size_t)d * erows + own, Dlocal + (size_t)d * rows, (size_t)rows * sizeof(double));
+    }
+
+    MPI_Type_vector(w, send_up, rows, MPI_DOUBLE, &s_up);
+    MPI_Type_vector(w, own, erows, MPI_DOUBLE, &r_down);
+    MPI_Type_vector(w, send_down, rows, MPI_DOUBLE, &s_down);
+    MPI_Type_vector(w, recv_up, erows, MPI_DOUBLE, &r_up);
+    MPI_Type_commit(&s_up);
+    MPI_Type_commit(&r_down);
+    MPI_Type_commit(&s_down);
+    MPI_Type_commit(&r_up);
+
+    MPI_Sendrecv(Dlocal + rows - send_up, 1, s_up, up, 2,
+                 Dext, 1, r_down, down, 2, comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(Dlocal, 1, s_down, down, 3,
+                 Dext + own + rows, 1, r_up, up, 3, comm, MPI_STATUS_IGNORE);
+
+    MPI_Type_free(&s_up);
+    MPI_Type_free(&r_down);
+    MPI_Type_free(&s_down);
+    MPI_Type_free(&r_up);
+}
+
+/*
+ * Communication-avoiding matrix powers: V[s] = A^s x for s = 1 .. k from
+ * V[0] = x, all windows over global rows [vlo, vlo + vlen) with my own rows
+ * filled in. One exchange brings k * kl / k * ku entries of x from the
+ * neighbours; step s then computes rows [row_off - (k - s) kl,
+ * row_off + rows + (k - s) ku) from step s - 1, i.e. each step redoes the
+ * neighbours' boundary rows it needs instead of asking for them. Dext holds
+ * the band rows [eoff, eoff + erows) covering step 1 (see
+ * exchange_ghost_rows). times[] += { exchange, local products }.
+ */
+static void matrix_powers_ca(const double *Dext, int eoff, int erows, int kl, int ku, int n,
+                             int row_off, int rows, int k, double **V, int vlo, int vlen,
+                             int rank, int p, MPI_Comm comm, double times[2])
+{
+    int hl = row_off - vlo;
+    int hu = vlo + vlen - (row_off + rows);
+
+    double t = MPI_Wtime();
+    exchange_halo(V[0], rows, k * kl, k * ku, hl, hu, rank, p, comm);
+    times[0] += MPI_Wtime() - t;
+
+    t = MPI_Wtime();
+    for (int s = 1; s <= k; s++) {
+        int r0 = row_off - (k - s) * kl;
+        int r1 = row_off + rows + (k - s) * ku;
+        if (r0 < 0) r0 = 0;
+        if (r1 > n) r1 = n;
+        band_product(Dext + (r0 - eoff), erows, r1 - r0, kl, ku, n, r0,
+                     V[s - 1], vlo, V[s] + (r0 - vlo));
+    }
+    times[1] += MPI_Wtime() - t;
+}
+
+/*
+ * Reference for matrix_powers_ca: k ordinary steps, each refreshing the
+ * kl / ku halo of W[s - 1] (xwin layout) and multiplying the own rows.
+ */
+static void matrix_powers_std(const double *Dlocal, int kl, int ku, int n, int row_off, int rows,
+                              int k, double **W, int xlo, int hl, int hu,
+                              int rank, int p, MPI_Comm comm, double times[2])
+{
+    for (int s = 1; s <= k; s++) {
+        double t = MPI_Wtime();
+        exchange_halo(W[s - 1], rows, kl, ku, hl, hu, rank, p, comm);
+        times[0] += MPI_Wtime() - t;
+
+        t = MPI_Wtime();
+        band_product(Dlocal, rows, rows, kl, ku, n, row_off, W[s - 1], xlo, W[s] + hl);
+        times[1] += MPI_Wtime() - t;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    int ok = (argc >= 5 && argc <= 9);
+    int kl = ok ? parse_nonneg_int(argv[3]) : -1;
+    int ku = ok ? parse_nonneg_int(argv[4]) : -1;
+
+    /* Optional relaxation: 0 = none, 1 = Jacobi, 2 = multicolor Gauss-Seidel. */
+    int relax = 0;
+    int max_sweeps = 1000;
+    int check_every = 10;
+    double tol = 1e-10;
+    /* Optional matrix powers depth, 0 = none. */
+    int powers = 0;
+    if (ok && argc >= 6) {
+        if (strcmp(argv[5], "jacobi") == 0) relax = 1;
+        else if (strcmp(argv[5], "mcgs") == 0) relax = 2;
+        else if (strcmp(argv[5], "powers") == 0 && argc == 7) powers = parse_nonneg_int(argv[6]);
+        else ok = 0;
+    }
+    if (ok && relax && argc >= 7) max_sweeps = parse_nonneg_int(argv[6]);
+    if (ok && relax && argc >= 8) check_every = parse_nonneg_int(argv[7]);
+    if (ok && relax && argc >= 9) tol = atof(argv[8]);
+
+    if (!ok || kl < 0 || ku < 0 || max_sweeps < 1 || check_every < 1 || !(tol >= 0.0) ||
+        (argc >= 6 && !relax && powers < 1)) {
+        if (rank == 0) {
+            fprintf(stderr, "Usage: %s <vector_file> <band_file> <kl> <ku> "
+                            "[jacobi|mcgs [max_sweeps [check_every [tol]]] | powers <k>]\n", argv[0]);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    const char *vec_file  = argv[1];
+    const char *band_file = argv[2];
+    int w = kl + ku + 1;
+
+    int n = 0;
+
+    /*
+     * Rank 0 determines n from the vector file. Element counts (n * w) are
+     * size_t and the band travels in units of w doubles, so only row counts
+     * reach the int MPI counts: n is limited to INT_MAX rows, not n * w.
+     */
+    if (rank == 0) {
+        long long nfile = count_doubles_in_file(vec_file);
+        if (nfile <= 0) {
+            fprintf(stderr, "ERROR: cannot read vector size from file '%s'\n", vec_file);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        if (nfile > INT_MAX) {
+            fprintf(stderr, "ERROR: n = %lld exceeds INT_MAX rows\n", nfile);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        n = (int)nfile;
+    }
+
+    MPI_Bcast(&n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if (kl >= n || ku >= n) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "kl and ku must be smaller than n");
+    }
+
+    /* Uneven row distribution, identical to MPI_Matrix_Vector_General. */
+    int q = n / p;
+    int r = n % p;
+
+    int local_rows = q + (rank < r ? 1 : 0);
+    int local_row_offset = rank * q + (rank < r ? rank : r);
+
+    /* x window touched by the local rows: columns [xlo, xhi). */
+    int xlo = local_row_offset - kl;
+    int xhi = local_row_offset + local_rows + ku;
+    if (xlo < 0) xlo = 0;
+    if (xhi > n) xhi = n;
+    int xlen = (local_rows > 0) ? xhi - xlo : 0;
+
+    int *sendcountsA = NULL;
+    int *displsA     = NULL;
+    int *sendcountsX = NULL;
+    int *displsX     = NULL;
+    int *recvcountsY = NULL;
+    int *displsY     = NULL;
+
+    if (rank == 0) {
+        sendcountsA = (int *)malloc((size_t)p * sizeof(int));
+        displsA     = (int *)malloc((size_t)p * sizeof(int));
+        sendcountsX = (int *)malloc((size_t)p * sizeof(int));
+        displsX     = (int *)malloc((size_t)p * sizeof(int));
+        recvcountsY = (int *)malloc((size_t)p * sizeof(int));
+        displsY     = (int *)malloc((size_t)p * sizeof(int));
+
+        if (!sendcountsA || !displsA || !sendcountsX || !displsX || !recvcountsY || !displsY) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for counts/displacements");
+        }
+
+        int disp = 0;
+        for (int i = 0; i < p; i++) {
+            int rows_i = q + (i < r ? 1 : 0);
+
+            sendcountsA[i] = rows_i;  /* band block: rows_i units of w doubles */
+            displsA[i]     = disp;
+
+            /*
+             * x windows of neighbouring ranks overlap by kl + ku entries.
+             * Overlapping send regions are legal for MPI_Scatterv.
+             */
+            int lo = disp - kl;
+            int hi = disp + rows_i + ku;
+            if (lo < 0) lo = 0;
+            if (hi > n) hi = n;
+            sendcountsX[i] = (rows_i > 0) ? hi - lo : 0;
+            displsX[i]     = (rows_i > 0) ? lo : 0;
+
+            recvcountsY[i] = rows_i;
+            displsY[i]     = disp;
+
+            disp += rows_i;
+        }
+    }
+
+    /* Rank 0 loads x and the band; the band is repacked per rank, diagonal-major. */
+    double *xfull = NULL;
+    double *Bsend = NULL;
+
+    if (rank == 0) {
+        xfull = load_doubles(vec_file, (size_t)n);
+        if (!xfull) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read vector file (format/size mismatch)");
+        }
+
+        double *AB = load_doubles(band_file, (size_t)w * (size_t)n);
+        if (!AB) {
+            free(xfull);
+            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read band file (format/size mismatch)");
+        }
+
+        Bsend = (double *)malloc((size_t)w * (size_t)n * sizeof(double));
+        if (!Bsend) {
+            free(xfull);
+            free(AB);
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for band send buffer");
+        }
+
+        for (int i = 0; i < p; i++) {
+            pack_block_diagonal_major(AB, n, kl, ku, displsY[i], recvcountsY[i],
+                                      &Bsend[(size_t)displsA[i] * (size_t)w]);
+        }
+        free(AB);
+    }
+
+    double *Dlocal = NULL;
+    double *xwin   = NULL;
+    double *ylocal = NULL;
+
+    if (local_rows > 0) {
+        Dlocal = (double *)malloc((size_t)local_rows * (size_t)w * sizeof(double));
+        xwin   = (double *)malloc((size_t)xlen * sizeof(double));
+        ylocal = (double *)malloc((size_t)local_rows * sizeof(double));
+        if (!Dlocal || !xwin || !ylocal) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for local band block");
+        }
+    }
+
+    /*
+     * Scatter the needed x windows (with halo) and the band row blocks. A
+     * block is rows_i * w contiguous doubles (diagonal-major inside), so it
+     * is sent as rows_i units of a w-double datatype and the counts stay row
+     * counts (like scatterv_rows in MPI_Matrix_Vector_General).
+     */
+    MPI_Datatype band_unit;
+    MPI_Type_contiguous(w, MPI_DOUBLE, &band_unit);
+    MPI_Type_commit(&band_unit);
+
+    MPI_Scatterv(
+        xfull, sendcountsX, displsX, MPI_DOUBLE,
+        xwin, xlen, MPI_DOUBLE,
+        0, MPI_COMM_WORLD
+    );
+
+    MPI_Scatterv(
+        Bsend, sendcountsA, displsA, band_unit,
+        Dlocal, local_rows, band_unit,
+        0, MPI_COMM_WORLD
+    );
+    MPI_Type_free(&band_unit);
+
+    /* Compute local result y_local = A_local * x_window */
+    if (local_rows > 0) {
+        if (kl == 1 && ku == 1) {
+            tridiag_matvec(Dlocal, local_rows, local_rows, n, local_row_offset, xwin, xlo, ylocal);
+        } else {
+            band_matvec(Dlocal, local_rows, local_rows, kl, ku, n, local_row_offset, xwin, xlo, ylocal);
+        }
+    }
+
+    double *y = NULL;
+    if (rank == 0) {
+        y = (double *)malloc((size_t)n * sizeof(double));
+        if (!y) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for full result y");
+        }
+    }
+
+    MPI_Gatherv(
+        ylocal, local_rows, MPI_DOUBLE,
+        y, recvcountsY, displsY, MPI_DOUBLE,
+        0, MPI_COMM_WORLD
+    );
+
+    if (rank == 0) {
+        write_result("Result.txt", y, n);
+    }
+
+    /*
+     * Relaxation for A u = x on the resident band blocks. The right-hand side
+     * of my rows is the own part of xwin; the iterate window uwin has the
+     * same layout as xwin, with kl lower and ku upper halo entries that are
+     * refreshed from the neighbours after every (half-)sweep.
+     */
+    if (relax) {
+        int minrows = (kl > ku) ? kl : ku;
+        if (q < minrows || q < 1) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "relaxation needs at least max(kl, ku) rows per rank");
+        }
+        int hl = local_row_offset - xlo;
+        int hu = xhi - (local_row_offset + local_rows);
+        const double *b = xwin + hl;
+
+        double *uwin = (double *)calloc((size_t)xlen, sizeof(double));
+        double *unew = (double *)malloc((size_t)local_rows * sizeof(double));
+        if (!uwin || !unew) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for relaxation");
+        }
+        for (int li = 0; li < local_rows; li++) {
+            if (Dlocal[(size_t)kl * local_rows + li] == 0.0) {
+                die_rank0_abort(MPI_COMM_WORLD, rank, "relaxation needs a nonzero diagonal");
+            }
+        }
+
+        double bb = 0.0;
+        for (int li = 0; li < local_rows; li++) bb += b[li] * b[li];
+        MPI_Allreduce(MPI_IN_PLACE, &bb, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        double bnorm = sqrt(bb);
+
+        double t_sweep = 0.0, t_halo = 0.0, t_chk = 0.0, t;
+        double relres = 1.0;
+        int sweep = 0, checks = 0;
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t_loop = MPI_Wtime();
+        /* mcgs: one color per band offset, so rows of a color never couple. */
+        int colors = (relax == 2) ? ((kl > ku) ? kl : ku) + 1 : 1;
+        while (sweep < max_sweeps) {
+            for (int c = 0; c < colors; c++) {
+                t = MPI_Wtime();
+                relax_band(Dlocal, local_rows, kl, ku, n, local_row_offset, b, uwin, xlo, unew,
+                           colors, relax == 2 ? c : -1);
+                memcpy(uwin + hl, unew, (size_t)local_rows * sizeof(double));
+                t_sweep += MPI_Wtime() - t;
+
+                t = MPI_Wtime();
+                exchange_halo(uwin, local_rows, kl, ku, hl, hu, rank, p, MPI_COMM_WORLD);
+                t_halo += MPI_Wtime() - t;
+            }
+            sweep++;
+
+            /* Residual every check_every sweeps: local band product + one MPI_Allreduce. */
+            if (sweep % check_every == 0 || sweep == max_sweeps) {
+                t = MPI_Wtime();
+                band_product(Dlocal, local_rows, local_rows, kl, ku, n, local_row_offset,
+                             uwin, xlo, ylocal);
+                double rr = 0.0;
+                for (int li = 0; li < local_rows; li++) {
+                    double d = b[li] - ylocal[li];
+                    rr += d * d;
+                }
+                MPI_Allreduce(MPI_IN_PLACE, &rr, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+                t_chk += MPI_Wtime() - t;
+                checks++;
+                relres = (bnorm > 0.0) ? sqrt(rr) / bnorm : sqrt(rr);
+                if (relres <= tol) break;
+            }
+        }
+        double t_local[4] = { t_sweep, t_halo, t_chk, MPI_Wtime() - t_loop };
+        double t_max[4];
+        MPI_Reduce(t_local, t_max, 4, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+        MPI_Gatherv(
+            uwin + hl, local_rows, MPI_DOUBLE,
+            y, recvcountsY, displsY, MPI_DOUBLE,
+            0, MPI_COMM_WORLD
+        );
+
+        if (rank == 0) {
+            write_result("Solution.txt", y, n);
+            printf("Relaxation (%s, %d color(s), halo exchange of %d + %d entries): %d sweep(s), %s, "
+                   "||r|| / ||b|| = %.3e (tol %g, %d residual check(s), one every %d sweep(s))\n",
+                   relax == 2 ? "multicolor Gauss-Seidel" : "Jacobi", colors, kl, ku, sweep,
+                   relres <= tol ? "converged" : "not converged", relres, tol, checks, check_every);
+            printf("Per sweep (max over ranks): %.2f us; compute %.2f us, halo exchange %.2f us, "
+                   "residual checks %.2f us\n",
+                   1e6 * t_max[3] / sweep, 1e6 * t_max[0] / sweep, 1e6 * t_max[1] / sweep,
+                   1e6 * t_max[2] / sweep);
+        }
+        free(uwin);
+        free(unew);
+    }
+
+    /*
+     * Matrix powers A^s x, s = 0 .. k. V[s] are windows over the rows that
+     * step s of matrix_powers_ca touches, W[s] windows in the xwin layout for
+     * the step-by-step reference; both start from the own part of x.
+     */
+    if (powers) {
+        int k = powers;
+        int minrows = k * ((kl > ku) ? kl : ku);
+        if (q < minrows || q < 1) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "matrix powers need at least k * max(kl, ku) rows per rank");
+        }
+        int own_end = local_row_offset + local_rows;
+        int hl = local_row_offset - xlo;
+        int hu = xhi - own_end;
+
+        /* Band rows of the ghost region, fetched once (A does not change between calls). */
+        int eoff = local_row_offset - (k - 1) * kl;
+        int eend = own_end + (k - 1) * ku;
+        if (eoff < 0) eoff = 0;
+        if (eend > n) eend = n;
+        int erows = eend - eoff;
+
+        int vlo = local_row_offset - k * kl;
+        int vhi = own_end + k * ku;
+        if (vlo < 0) vlo = 0;
+        if (vhi > n) vhi = n;
+        int vlen = vhi - vlo;
+
+        double *Dext = (double *)malloc((size_t)erows * (size_t)w * sizeof(double));
+        double **V = (double **)malloc((size_t)(k + 1) * sizeof(double *));
+        double **W = (double **)malloc((size_t)(k + 1) * sizeof(double *));
+        if (!Dext || !V || !W) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for matrix powers");
+        }
+        for (int s = 0; s <= k; s++) {
+            V[s] = (double *)calloc((size_t)vlen, sizeof(double));
+            W[s] = (double *)calloc((size_t)xlen, sizeof(double));
+            if (!V[s] || !W[s]) {
+                die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for matrix powers");
+            }
+        }
+
+        double t_setup = MPI_Wtime();
+        exchange_ghost_rows(Dlocal, local_rows, w, (k - 1) * kl, (k - 1) * ku, Dext, erows,
+                            rank, p, MPI_COMM_WORLD);
+        t_setup = MPI_Wtime() - t_setup;
+
+        /* Time both variants over several calls; every call restarts from x. */
+        const int reps = 20;
+        double t_ca[2] = { 0.0, 0.0 }, t_std[2] = { 0.0, 0.0 };
+        for (int it = 0; it < reps; it++) {
+            memcpy(V[0] + (local_row_offset - vlo), xwin + hl, (size_t)local_rows * sizeof(double));
+            MPI_Barrier(MPI_COMM_WORLD);
+            matrix_powers_ca(Dext, eoff, erows, kl, ku, n, local_row_offset, local_rows, k,
+                             V, vlo, vlen, rank, p, MPI_COMM_WORLD, t_ca);
+
+            memcpy(W[0] + hl, xwin + hl, (size_t)local_rows * sizeof(double));
+            MPI_Barrier(MPI_COMM_WORLD);
+            matrix_powers_std(Dlocal, kl, ku, n, local_row_offset, local_rows, k,
+                              W, xlo, hl, hu, rank, p, MPI_COMM_WORLD, t_std);
+        }
+
+        /* Both variants run the same per-row kernel, so they must agree bitwise. */
+        double diff = 0.0;
+        long long redundant = 0;
+        for (int s = 1; s <= k; s++) {
+            for (int li = 0; li < local_rows; li++) {
+                double d = fabs(V[s][local_row_offset - vlo + li] - W[s][hl + li]);
+                if (d > diff) diff = d;
+            }
+            int r0 = local_row_offset - (k - s) * kl;
+            int r1 = own_end + (k - s) * ku;
+            if (r0 < 0) r0 = 0;
+            if (r1 > n) r1 = n;
+            redundant += (r1 - r0) - local_rows;
+        }
+        double t_local[5] = { t_ca[0], t_ca[1], t_std[0], t_std[1], t_setup };
+        double t_max[5];
+        long long redundant_sum = 0;
+        MPI_Reduce(t_local, t_max, 5, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&redundant, &redundant_sum, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, &diff, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+        FILE *f = NULL;
+        if (rank == 0) {
+            f = fopen("Powers.txt", "w");
+        }
+        for (int s = 0; s <= k; s++) {
+            MPI_Gatherv(
+                V[s] + (local_row_offset - vlo), local_rows, MPI_DOUBLE,
+                y, recvcountsY, displsY, MPI_DOUBLE,
+                0, MPI_COMM_WORLD
+            );
+            if (f) {
+                for (int i = 0; i < n; i++) {
+                    fprintf(f, "%lf%s", y[i], (i + 1 == n) ? "" : " ");
+                }
+                fprintf(f, "\n");
+            }
+        }
+        if (f) fclose(f);
+
+        if (rank == 0) {
+            printf("Matrix powers A^s x, s = 0 .. %d: one halo exchange of %d + %d entries instead "
+                   "of %d exchanges of %d + %d; %lld redundant row products (%.1f%% extra work); "
+                   "ghost band rows fetched once in %.2f us\n",
+                   k, k * kl, k * ku, k, kl, ku, redundant_sum,
+                   100.0 * (double)redundant_sum / ((double)k * n), 1e6 * t_max[4]);
+            printf("Per call (max over ranks, %d calls): communication-avoiding %.2f us "
+                   "(exchange %.2f us, products %.2f us); step by step %.2f us "
+                   "(exchanges %.2f us, products %.2f us); max |difference| = %g\n",
+                   reps, 1e6 * (t_max[0] + t_max[1]) / reps, 1e6 * t_max[0] / reps,
+                   1e6 * t_max[1] / reps, 1e6 * (t_max[2] + t_max[3]) / reps,
+                   1e6 * t_max[2] / reps, 1e6 * t_max[3] / reps, diff);
+        }
+
+        for (int s = 0; s <= k; s++) {
+            free(V[s]);
+            free(W[s]);
+        }
+        free(V);
+        free(W);
+        free(Dext);
+    }
+
+    /* Cleanup */
+    free(Dlocal);
+    free(xwin);
+    free(ylocal);
+
+    if (rank == 0) {
+        free(xfull);
+        free(Bsend);
+        free(y);
+        free(sendcountsA);
+        free(displsA);
+        free(sendcountsX);
+        free(displsX);
+        free(recvcountsY);
+        free(displsY);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,67 @@
+@echo off
+setlocal
+
+rem --------------------------------------------------------------------
+rem  Modify PATH so MinGW DLLs are used first (prevents popup issues)
+rem --------------------------------------------------------------------
+set "PATH=C:\msys64\mingw64\bin;%PATH%"
+
+rem --------------------------------------------------------------------
+rem  Define Microsoft MPI include & library folders (NO trailing '\')
+rem --------------------------------------------------------------------
+set "MSMPI_INC=C:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+set "MSMPI_LIB64=C:\Program Files (x86)\Microsoft SDKs\MPI\Lib\x64"
+
+rem --------------------------------------------------------------------
+rem  Move to directory where the script is located
+rem --------------------------------------------------------------------
+cd /d %~dp0
+
+rem --------------------------------------------------------------------
+rem  Input files and band widths
+rem  Usage: MPI_Matrix_Vector_Banded.cmd [num_procs]
+rem  Band.txt holds a tridiagonal matrix (kl = ku = 1) in LAPACK AB layout.
+rem  Append e.g. "mcgs 1000 10" (or "jacobi") to the mpiexec line to also
+rem  solve A u = x by relaxation with halo exchange (writes Solution.txt).
+rem  Or append "powers 4" for x, A x, ..., A^4 x with one deep halo exchange
+rem  (writes Powers.txt).
+rem --------------------------------------------------------------------
+set "VEC_FILE=Vector.txt"
+set "BAND_FILE=Band.txt"
+set KL=1
+set KU=1
+
+rem Optional: number of MPI processes (default = 4)
+if "%~1"=="" (
+    set NP=4
+) else (
+    set NP=%~1
+)
+
+rem --------------------------------------------------------------------
+rem  Build the MPI banded matrix-vector program
+rem  -O3 lets gcc vectorize the diagonal sweeps of the band kernel.
+rem --------------------------------------------------------------------
+echo Building MPI_Matrix_Vector_Banded.c ...
+gcc MPI_Matrix_Vector_Banded.c ^
+  -O3 -march=native ^
+  -I"%MSMPI_INC%" ^
+  -L"%MSMPI_LIB64%" ^
+  -lmsmpi ^
+  -o MPI_Matrix_Vector_Banded.exe
+
+if %errorlevel% neq 0 (
+    echo [ERROR] Compilation failed!
+    exit /b 1
+)
+
+echo Build completed successfully.
+
+rem --------------------------------------------------------------------
+rem  Run the MPI program
+rem --------------------------------------------------------------------
+echo Running: mpiexec -n %NP% MPI_Matrix_Vector_Banded.exe %VEC_FILE% %BAND_FILE% %KL% %KU%
+echo --------------------------------------------------------------
+call mpiexec -n %NP% MPI_Matrix_Vector_Banded.exe "%VEC_FILE%" "%BAND_FILE%" %KL% %KU%
+
+endlocal
@@ -1,25 +1,145 @@
+#if defined(__linux__)
+#define _GNU_SOURCE  /* sched_setaffinity in MPI_Topology.h */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <stdint.h>
 #include <mpi.h>
 
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "../MPI_Common/MPI_Topology.h"
+
 /*
  * Generalized dense matrix-vector multiplication: y = A * x
  *
  * Key feature:
- *  - Works for any n and any number of processes (n does NOT need to be a multiple of p).
+ *  - Works for any m x n and any number of processes (m does NOT need to be a multiple of p).
  *  - Uses uneven row-block distribution with MPI_Scatterv / MPI_Gatherv.
+ *  - 64-bit sizes and indexing throughout. Transfers larger than 2^31 elements
+ *    use the MPI-4 large-count (_c) collectives when available, otherwise
+ *    counts are expressed in rows of a contiguous derived datatype.
+ *  - 64-byte aligned, huge-page advised buffers, first-touched by the OpenMP
+ *    threads that compute on them (build with -fopenmp; OMP_NUM_THREADS
+ *    threads per rank).
+ *  - Optional int8/int16 matrix storage with one fp64 scale per row: 8x (4x)
+ *    less scatter volume and local memory, dequantized inside a SIMD dot
+ *    product that accumulates in fp64.
+ *  - Optional 2D block-checkerboard distribution on a Cartesian process grid:
+ *    x is broadcast only down process columns and partial y is reduced only
+ *    across process rows (see run_2d).
+ *  - Optional column-block distribution for short and wide matrices: no x
+ *    broadcast, partial y combined with MPI_Reduce_scatter (see run_cols).
+ *  - Optional automatic choice among those three from a latency/bandwidth
+ *    cost model of the machine (see choose_distribution).
  *
  * Input format (whitespace separated doubles):
  *  - Vector file: n doubles
- *  - Matrix file: n*n doubles in row-major order
+ *  - Matrix file: m*n doubles in row-major order (m is derived from the count)
  *
  * Usage:
- *   mpiexec -n <p> MPI_Matrix_Vector_General <vector_file> <matrix_file>
+ *   mpiexec -n <p> MPI_Matrix_Vector_General <vector_file> <matrix_file> [options]
+ *
+ * Options:
+ *   --repro   reproducible row dot products: bitwise-identical results for any
+ *             process count, loop order or SIMD width (see repro_dot);
+ *             Result.txt is then written with 17 significant digits
+ *   --bind=P  pin ranks and OpenMP threads before any allocation; P is
+ *             compact, scatter, numa or none. Prints topology and placement.
+ *   --quant=Q quantized matrix storage, Q is int8 or int16 (see quantize_rows)
+ *   --verify  rank 0 recomputes y in fp64 from the full matrix and reports
+ *             the maximum absolute and relative error of the result
+ *   --dist=D  row (default): row blocks, every rank receives all of x
+ *             2d: Pr x Pc block checkerboard (not combinable with --quant)
+ *             col: column blocks + x slices, y combined by MPI_Reduce_scatter
+ *             auto: the cheapest of the three under the cost model; the
+ *             measured latency, bandwidth and speed are cached per machine
+ *             in MatvecModel_<host>.txt (delete it to measure again)
+ *   --bcast=B  how x is broadcast (row and 2d distributions): lib (default,
+ *             MPI_Bcast) or a segmented pipeline over MPI_Isend/MPI_Irecv
+ *             along a chain or a binary tree (see pipelined_bcast); chain and
+ *             tree need an explicit --dist=row|2d
+ *   --segment=KB  pipeline segment size for --bcast=chain|tree (default 128)
+ *   --bcast-bench  before the matvec, time MPI_Bcast against the chain and
+ *             tree pipelines for 8 KB .. max(64 MB, x) and print the
+ *             bytes / bandwidth lower bound next to them
+ *   --mem-limit=MB  (--dist=auto) skip distributions needing more than MB
+ *             megabytes of matrix and vector storage per rank
+ *   --shared-x  (row distribution) one copy of x per node in an MPI-3 shared
+ *             memory window instead of one per rank (see shared_vector_alloc)
+ *   --overlap[=K]  (row distribution, fp64) pipeline x and A in K chunks
+ *             (default 8) with MPI_Ibcast / MPI_Iscatterv and compute while
+ *             they arrive instead of the blocking broadcast + scatter;
+ *             reports the communication span, the exposed wait and the
+ *             hidden communication (span - wait, see overlap_pipeline)
+ *   --rma[=K]  (row distribution, fp64) rank 0 exposes A in an MPI window
+ *             and every rank pulls its own rows with K (default 8) MPI_Rget
+ *             chunks instead of MPI_Scatterv, computing each chunk as it
+ *             lands (see rma_fetch_rows)
+ *   --repeat=N  (row distribution) time N iterative steps (x bcast, local
+ *             matvec, y allgatherv) with blocking and with MPI-4 persistent
+ *             collectives (see repeat_iterations)
+ *   --power=N  (row distribution, square A) after the matvec, up to N power
+ *             iterations on the resident row blocks starting from x; prints
+ *             the dominant eigenvalue estimate and per-iteration timing and
+ *             writes the eigenvector to Eigenvector.txt (see power_iteration)
+ *   --tol=T   --power stops once successive estimates differ by at most
+ *             T * |lambda|, --cg once ||r|| <= T * ||b|| (default 1e-10)
+ *   --cg=N    (row distribution, square SPD A, fp64) after the matvec,
+ *             solve A x = v for the input vector v with at most N conjugate
+ *             gradient iterations on the resident row blocks; the solution
+ *             goes to Solution.txt, the residual history to Residuals.txt
+ *             (see cg_solve)
+ *   --precond=P  none (default) or jacobi (diagonal of A) for --cg
+ *   --cg-fused  Chronopoulos-Gear CG: one MPI_Allreduce per iteration
+ *             instead of two
+ *   --relax=R  (row distribution, square A with nonzero diagonal, fp64)
+ *             after the matvec, solve A x = v by jacobi or twocolor
+ *             (two-color block Jacobi: even rows, then odd rows) sweeps on
+ *             the resident row blocks, x exchanged with MPI_Allgatherv; solution in Solution.txt (see relax_solve;
+ *             the banded program has the halo-exchange version)
+ *   --sweeps=N  --relax sweep limit (default 1000)
+ *   --check-every=K  --relax residual check (one MPI_Allreduce) every K
+ *             sweeps (default 10); stops once ||r|| <= --tol * ||v||
+ *   --result=R  where y ends up: root (default, gathered to rank 0 and
+ *             written to Result.txt), all (MPI_Allgatherv, every rank holds
+ *             y) or dist (each rank keeps its row block for the next step;
+ *             no Result.txt, rank 0 prints ||y||_2 instead)
+ *   --weights=W  (row distribution) split rows in proportion to per-rank
+ *             speed instead of evenly: W is bench (short calibration kernel
+ *             on every rank) or a profile file with one weight per rank
+ *   --save-weights=F  write every rank's measured throughput of this run to
+ *             F, usable as --weights=F on the next run (see row_weights)
  *
  * Output (rank 0):
- *   Result.txt containing n doubles (space-separated)
+ *   Result.txt containing m doubles (space-separated), unless --result=dist
  */
 
+#if defined(MPI_VERSION) && MPI_VERSION >= 4
+#define MATVEC_LARGE_COUNT 1
+#else
+#define MATVEC_LARGE_COUNT 0
+#endif
+
+/* Block size used to describe more than INT_MAX doubles with one datatype. */
+#define BIG_CHUNK (1LL << 30)
+
 static void die_rank0_abort(MPI_Comm comm, int rank, const char *msg)
 {
     if (rank == 0) {
@@ -28,13 +148,81 @@ static void die_rank0_abort(MPI_Comm comm, int rank, const char *msg)
     MPI_Abort(comm, 1);
 }
 
-/* Count how many doubles are present in a file (vector size). */
-static int count_doubles_in_file(const char *fname)
+/*
+ * Allocation layer for matrix/vector buffers.
+ *
+ * matvec_alloc() returns MATVEC_ALIGN-byte aligned memory (one AVX-512 vector /
+ * cache line). On Linux, buffers of at least one huge page are aligned to
+ * HUGE_PAGE_SIZE and advised with MADV_HUGEPAGE so transparent huge pages back
+ * them. Pages are not touched here: first_touch_rows() touches them with the
+ * same OpenMP static schedule the compute loop uses, so each page is placed on
+ * the NUMA node of the thread that later works on it (MPI receives then write
+ * into already-placed pages).
+ */
+#define MATVEC_ALIGN    64
+#define HUGE_PAGE_SIZE  ((size_t)2 << 20)
+
+/* Alignment matvec_alloc uses for a buffer of the given size. */
+static size_t matvec_align_for(size_t bytes)
+{
+    return (bytes >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : MATVEC_ALIGN;
+}
+
+/* Ask for transparent huge pages on a HUGE_PAGE_SIZE-aligned buffer. */
+static void advise_huge_pages(void *ptr, size_t bytes)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    /* Advisory only: failure just means regular 4 KiB pages. */
+    madvise(ptr, (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1), MADV_HUGEPAGE);
+#else
+    (void)ptr;
+    (void)bytes;
+#endif
+}
+
+static void *matvec_alloc(size_t bytes)
+{
+    if (bytes == 0) bytes = MATVEC_ALIGN;
+
+#if defined(_WIN32)
+    return _aligned_malloc(bytes, MATVEC_ALIGN);
+#else
+    size_t align = matvec_align_for(bytes);
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, align, bytes) != 0) return NULL;
+    if (align == HUGE_PAGE_SIZE) advise_huge_pages(ptr, bytes);
+    return ptr;
+#endif
+}
+
+static void matvec_free(void *ptr)
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+/*
+ * Zero rows x row_bytes bytes in parallel, row i by the thread that the
+ * compute loop's schedule(static) assigns row i to.
+ */
+static void first_touch_rows(void *buf, long long rows, size_t row_bytes)
+{
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < rows; i++) {
+        memset((char *)buf + (size_t)i * row_bytes, 0, row_bytes);
+    }
+}
+
+/* Count how many doubles are present in a file (vector size / matrix entries). */
+static long long count_doubles_in_file(const char *fname)
 {
     FILE *f = fopen(fname, "r");
     if (!f) return -1;
 
-    int count = 0;
+    long long count = 0;
     double tmp;
     while (fscanf(f, "%lf", &tmp) == 1) {
         count++;
@@ -43,17 +231,17 @@ static int count_doubles_in_file(const char *fname)
     return count;
 }
 
-static double *load_vector(const char *fname, int n)
+static double *load_vector(const char *fname, size_t n)
 {
     FILE *f = fopen(fname, "r");
     if (!f) return NULL;
 
-    double *x = (double *)malloc((size_t)n * sizeof(double));
+    double *x = (double *)matvec_alloc(n * sizeof(double));
     if (!x) { fclose(f); return NULL; }
 
-    for (int i = 0; i < n; i++) {
+    for (size_t i = 0; i < n; i++) {
         if (fscanf(f, "%lf", &x[i]) != 1) {
-            free(x);
+            matvec_free(x);
             fclose(f);
             return NULL;
         }
@@ -62,18 +250,18 @@ static double *load_vector(const char *fname, int n)
     return x;
 }
 
-static double *load_matrix(const char *fname, int n)
+static double *load_matrix(const char *fname, size_t m, size_t n)
 {
     FILE *f = fopen(fname, "r");
     if (!f) return NULL;
 
-    size_t m = (size_t)n * (size_t)n;
-    double *A = (double *)malloc(m * sizeof(double));
+    size_t count = m * n;
+    double *A = (double *)matvec_alloc(count * sizeof(double));
     if (!A) { fclose(f); return NULL; }
 
-    for (size_t i = 0; i < m; i++) {
+    for (size_t i = 0; i < count; i++) {
         if (fscanf(f, "%lf", &A[i]) != 1) {
-            free(A);
+            matvec_free(A);
             fclose(f);
             return NULL;
         }
@@ -82,190 +270,3033 @@ static double *load_matrix(const char *fname, int n)
     return A;
 }
 
-static void write_result(const char *fname, const double *y, int n)
+/* full_precision != 0 prints round-trip exact values (for bitwise comparisons). */
+static void write_result(const char *fname, const double *y, size_t n, int full_precision)
 {
     FILE *f = fopen(fname, "w");
     if (!f) return;
 
-    for (int i = 0; i < n; i++) {
-        fprintf(f, "%lf%s", y[i], (i + 1 == n) ? "" : " ");
+    for (size_t i = 0; i < n; i++) {
+        fprintf(f, full_precision ? "%.17g%s" : "%lf%s", y[i], (i + 1 == n) ? "" : " ");
     }
     fprintf(f, "\n");
     fclose(f);
 }
 
-int main(int argc, char **argv)
+/*
+ * Reproducible dot products (pre-rounded / binned summation).
+ *
+ * Each product v = a[j] * x[j] is split against REPRO_FOLDS shrinking
+ * boundaries sigma_k = 1.5 * 2^e_k. Adding and subtracting sigma_k rounds v to
+ * a multiple of ulp(sigma_k), and the sum of those rounded parts is exact in
+ * any order as long as every part shares the same boundary. The boundaries
+ * depend only on max |v| over the whole dot product and on the total length,
+ * so the result does not depend on loop order, SIMD width or on how the terms
+ * are split across ranks: partial fold vectors can be combined with a plain
+ * MPI_SUM and are still exact.
+ *
+ * Requires -ffp-contract=off so that (sigma + a*x) is not fused into an FMA.
+ */
+#define REPRO_FOLDS 3
+#define REPRO_LANES 8
+
+/* Boundary exponents for terms with max magnitude maxabs over a length-n sum. */
+static void repro_boundaries(double maxabs, long long n, double sigma[REPRO_FOLDS])
 {
-    MPI_Init(&argc, &argv);
+    int e;
+    int L = 1;
+    while ((1LL << L) < n) L++;
+    L++;
 
-    int rank, p;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &p);
+    frexp(maxabs, &e);  /* maxabs < 2^e */
+    for (int k = 0; k < REPRO_FOLDS; k++) {
+        sigma[k] = 1.5 * ldexp(1.0, e + L - k * (53 - L));
+    }
+}
 
-    if (argc != 3) {
-        if (rank == 0) {
-            fprintf(stderr, "Usage: %s <vector_file> <matrix_file>\n", argv[0]);
+/* max_j |a[j] * x[j]|; NaN/Inf propagate to the caller. */
+static double repro_max_abs_product(const double *a, const double *x, size_t len)
+{
+    double m[REPRO_LANES] = { 0.0 };
+    size_t j = 0;
+
+    for (; j + REPRO_LANES <= len; j += REPRO_LANES) {
+        for (int l = 0; l < REPRO_LANES; l++) {
+            double v = fabs(a[j + l] * x[j + l]);
+            m[l] = (v > m[l] || v != v) ? v : m[l];
         }
-        MPI_Finalize();
-        return 1;
+    }
+    for (; j < len; j++) {
+        double v = fabs(a[j] * x[j]);
+        m[0] = (v > m[0] || v != v) ? v : m[0];
     }
 
-    const char *vec_file = argv[1];
-    const char *mat_file = argv[2];
+    double r = m[0];
+    for (int l = 1; l < REPRO_LANES; l++) r = (m[l] > r || m[l] != m[l]) ? m[l] : r;
+    return r;
+}
 
-    int n = 0;
+/*
+ * Accumulate sum_j a[j] * x[j] into folds[] using the given boundaries.
+ * Each lane keeps its own fold sums; lanes are combined exactly at the end.
+ */
+static void repro_dot_folds(const double *a, const double *x, size_t len,
+                            const double sigma[REPRO_FOLDS], double folds[REPRO_FOLDS])
+{
+    double acc[REPRO_FOLDS][REPRO_LANES] = { { 0.0 } };
+    size_t j = 0;
 
-    /* Rank 0 determines n from the vector file. */
-    if (rank == 0) {
-        n = count_doubles_in_file(vec_file);
-        if (n <= 0) {
-            fprintf(stderr, "ERROR: cannot read vector size from file '%s'\n", vec_file);
-            MPI_Abort(MPI_COMM_WORLD, 1);
+    for (; j + REPRO_LANES <= len; j += REPRO_LANES) {
+        for (int l = 0; l < REPRO_LANES; l++) {
+            double v = a[j + l] * x[j + l];
+            for (int k = 0; k < REPRO_FOLDS; k++) {
+                double q = (sigma[k] + v) - sigma[k];
+                acc[k][l] += q;
+                v -= q;
+            }
+        }
+    }
+    for (; j < len; j++) {
+        double v = a[j] * x[j];
+        for (int k = 0; k < REPRO_FOLDS; k++) {
+            double q = (sigma[k] + v) - sigma[k];
+            acc[k][0] += q;
+            v -= q;
         }
     }
 
-    /* Broadcast n to all ranks. */
-    MPI_Bcast(&n, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    for (int k = 0; k < REPRO_FOLDS; k++) {
+        for (int l = 0; l < REPRO_LANES; l++) folds[k] += acc[k][l];
+    }
+}
+
+/* Collapse fold sums, most significant first (fixed order). */
+static double repro_fold_sum(const double folds[REPRO_FOLDS])
+{
+    double s = 0.0;
+    for (int k = 0; k < REPRO_FOLDS; k++) s += folds[k];
+    return s;
+}
+
+/* Reproducible dot product of one full row. */
+static double repro_dot(const double *a, const double *x, size_t len)
+{
+    double m = repro_max_abs_product(a, x, len);
+
+    if (m == 0.0) return 0.0;
+    if (!isfinite(m) || m > 0x1p900 || m < 0x1p-800) {
+        /* Non-finite or extreme range: plain sequential sum (still order-fixed). */
+        double sum = 0.0;
+        for (size_t j = 0; j < len; j++) sum += a[j] * x[j];
+        return sum;
+    }
 
-    /* Compute uneven row distribution: rows_i and offset_i for each rank i. */
-    int q = n / p;
-    int r = n % p;
+    double sigma[REPRO_FOLDS];
+    double folds[REPRO_FOLDS] = { 0.0 };
+    repro_boundaries(m, (long long)len, sigma);
+    repro_dot_folds(a, x, len, sigma, folds);
+    return repro_fold_sum(folds);
+}
 
-    int local_rows = q + (rank < r ? 1 : 0);
-    int local_row_offset = rank * q + (rank < r ? rank : r);
+/*
+ * Large-count transfer helpers.
+ *
+ * With MPI-4 the _c collectives take MPI_Count counts and MPI_Aint
+ * displacements directly. Older libraries (e.g. MS-MPI) get a contiguous
+ * "row" datatype of n doubles, so int counts only have to hold row numbers.
+ */
 
-    /* Prepare counts/displacements for Scatterv/Gatherv (rank 0 needs full arrays). */
-    int *sendcountsA = NULL;
-    int *displsA     = NULL;
-    int *recvcountsY = NULL;
-    int *displsY     = NULL;
+/* Contiguous datatype of count elements of type elem; also valid for count > INT_MAX. */
+static void make_contiguous(long long count, MPI_Datatype elem, MPI_Datatype *type)
+{
+    if (count <= INT_MAX) {
+        MPI_Type_contiguous((int)count, elem, type);
+    } else {
+        long long nchunks = count / BIG_CHUNK;
+        long long rem     = count % BIG_CHUNK;
 
-    if (rank == 0) {
-        sendcountsA = (int *)malloc((size_t)p * sizeof(int));
-        displsA     = (int *)malloc((size_t)p * sizeof(int));
-        recvcountsY = (int *)malloc((size_t)p * sizeof(int));
-        displsY     = (int *)malloc((size_t)p * sizeof(int));
+        MPI_Aint lb, extent;
+        MPI_Type_get_extent(elem, &lb, &extent);
 
-        if (!sendcountsA || !displsA || !recvcountsY || !displsY) {
-            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for counts/displacements");
-        }
+        MPI_Datatype parts[2];
+        int          blocklens[2] = { 1, 1 };
+        MPI_Aint     displs[2]    = { 0, (MPI_Aint)(nchunks * BIG_CHUNK * (long long)extent) };
 
-        int dispA = 0;
-        int dispY = 0;
-        for (int i = 0; i < p; i++) {
-            int rows_i = q + (i < r ? 1 : 0);
+        MPI_Type_vector((int)nchunks, (int)BIG_CHUNK, (int)BIG_CHUNK, elem, &parts[0]);
+        MPI_Type_contiguous((int)rem, elem, &parts[1]);
+        MPI_Type_create_struct(rem > 0 ? 2 : 1, blocklens, displs, parts, type);
+        MPI_Type_free(&parts[0]);
+        MPI_Type_free(&parts[1]);
+    }
+    MPI_Type_commit(type);
+}
 
-            sendcountsA[i] = rows_i * n;  /* matrix chunk is rows_i rows, each row has n cols */
-            displsA[i]     = dispA;
+static void bcast_doubles(double *buf, long long count, int root, MPI_Comm comm)
+{
+#if MATVEC_LARGE_COUNT
+    MPI_Bcast_c(buf, (MPI_Count)count, MPI_DOUBLE, root, comm);
+#else
+    if (count <= INT_MAX) {
+        MPI_Bcast(buf, (int)count, MPI_DOUBLE, root, comm);
+    } else {
+        MPI_Datatype whole;
+        make_contiguous(count, MPI_DOUBLE, &whole);
+        MPI_Bcast(buf, 1, whole, root, comm);
+        MPI_Type_free(&whole);
+    }
+#endif
+}
 
-            recvcountsY[i] = rows_i;      /* result chunk is rows_i entries */
-            displsY[i]     = dispY;
+/*
+ * Pipelined segmented broadcast of count doubles from root: the buffer is cut
+ * into segments of seg doubles that travel down a chain (tree == 0) or a
+ * binary tree (tree == 1) of the ranks numbered relative to root. Every
+ * receive is posted up front and each segment is forwarded as soon as it has
+ * arrived, so consecutive segments occupy different links at the same time.
+ * For count >> seg a chain approaches count * 8 / bandwidth independent of p
+ * (plus p - 2 segment steps to fill the pipe); the tree fills in log2(p)
+ * steps but interior ranks send every segment twice.
+ */
+static void pipelined_bcast(double *buf, long long count, long long seg, int tree,
+                            int root, MPI_Comm comm)
+{
+    int rank, p;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &p);
+    if (p == 1 || count == 0) return;
 
-            dispA += sendcountsA[i];
-            dispY += recvcountsY[i];
-        }
+    /* Parent and children in the numbering relative to root. */
+    int me = (rank - root + p) % p;
+    int parent = -1;
+    int child[2];
+    int nchild = 0;
+    if (tree) {
+        if (me > 0) parent = (me - 1) / 2;
+        if (2 * me + 1 < p) child[nchild++] = 2 * me + 1;
+        if (2 * me + 2 < p) child[nchild++] = 2 * me + 2;
+    } else {
+        if (me > 0) parent = me - 1;
+        if (me + 1 < p) child[nchild++] = me + 1;
     }
+    if (parent >= 0) parent = (parent + root) % p;
+    for (int c = 0; c < nchild; c++) child[c] = (child[c] + root) % p;
 
-    /* Allocate and load x (broadcast to all). */
-    double *x = (double *)malloc((size_t)n * sizeof(double));
-    if (!x) {
-        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for vector x");
+    long long nseg = (count + seg - 1) / seg;
+    MPI_Request *rreq = (MPI_Request *)malloc((size_t)nseg * sizeof(MPI_Request));
+    MPI_Request *sreq = (MPI_Request *)malloc((size_t)nseg * 2 * sizeof(MPI_Request));
+    if (!rreq || !sreq || nseg * 2 > INT_MAX) {
+        die_rank0_abort(comm, rank, "too many broadcast segments (increase --segment)");
     }
 
-    if (rank == 0) {
-        double *tmp = load_vector(vec_file, n);
-        if (!tmp) {
-            free(x);
-            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read vector file (format/size mismatch)");
+    /* Segments of one pair arrive in order, so a single tag is enough. */
+    if (parent >= 0) {
+        for (long long sg = 0; sg < nseg; sg++) {
+            long long len = (sg + 1 < nseg) ? seg : count - sg * seg;
+            MPI_Irecv(&buf[sg * seg], (int)len, MPI_DOUBLE, parent, 0, comm, &rreq[sg]);
         }
-        for (int i = 0; i < n; i++) x[i] = tmp[i];
-        free(tmp);
     }
+    int nsend = 0;
+    for (long long sg = 0; sg < nseg; sg++) {
+        long long len = (sg + 1 < nseg) ? seg : count - sg * seg;
+        if (parent >= 0) {
+            MPI_Wait(&rreq[sg], MPI_STATUS_IGNORE);
+        }
+        for (int c = 0; c < nchild; c++) {
+            MPI_Isend(&buf[sg * seg], (int)len, MPI_DOUBLE, child[c], 0, comm, &sreq[nsend++]);
+        }
+    }
+    MPI_Waitall(nsend, sreq, MPI_STATUSES_IGNORE);
+
+    free(rreq);
+    free(sreq);
+}
 
-    MPI_Bcast(x, n, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+/*
+ * Scatter uneven blocks of rows, each row_len elements of type elem long.
+ * rowcounts/rowdispls (in rows) are only significant on root.
+ */
+static void scatterv_rows(const void *sendbuf, const long long *rowcounts,
+                          const long long *rowdispls, long long row_len, MPI_Datatype elem,
+                          void *recvbuf, long long local_rows,
+                          int root, MPI_Comm comm)
+{
+    int rank, p;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &p);
 
-    /* Rank 0 loads full matrix A; others keep NULL. */
-    double *Afull = NULL;
-    if (rank == 0) {
-        Afull = load_matrix(mat_file, n);
-        if (!Afull) {
-            free(x);
-            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read matrix file (format/size mismatch)");
+#if MATVEC_LARGE_COUNT
+    MPI_Count *counts = NULL;
+    MPI_Aint  *displs = NULL;
+    if (rank == root) {
+        counts = (MPI_Count *)malloc((size_t)p * sizeof(MPI_Count));
+        displs = (MPI_Aint *)malloc((size_t)p * sizeof(MPI_Aint));
+        if (!counts || !displs) {
+            die_rank0_abort(comm, rank, "out of memory for counts/displacements");
+        }
+        for (int i = 0; i < p; i++) {
+            counts[i] = (MPI_Count)(rowcounts[i] * row_len);
+            displs[i] = (MPI_Aint)(rowdispls[i] * row_len);
+        }
+    }
+    MPI_Scatterv_c(sendbuf, counts, displs, elem,
+                   recvbuf, (MPI_Count)(local_rows * row_len), elem, root, comm);
+    free(counts);
+    free(displs);
+#else
+    int *counts = NULL;
+    int *displs = NULL;
+    if (rank == root) {
+        counts = (int *)malloc((size_t)p * sizeof(int));
+        displs = (int *)malloc((size_t)p * sizeof(int));
+        if (!counts || !displs) {
+            die_rank0_abort(comm, rank, "out of memory for counts/displacements");
+        }
+        for (int i = 0; i < p; i++) {
+            if (rowdispls[i] + rowcounts[i] > INT_MAX) {
+                die_rank0_abort(comm, rank, "more than INT_MAX rows requires an MPI-4 library");
+            }
+            counts[i] = (int)rowcounts[i];
+            displs[i] = (int)rowdispls[i];
         }
     }
 
-    /* Allocate local matrix chunk: local_rows * n */
-    double *Alocal = NULL;
-    if (local_rows > 0) {
-        Alocal = (double *)malloc((size_t)local_rows * (size_t)n * sizeof(double));
-        if (!Alocal) {
-            free(x);
-            if (rank == 0) free(Afull);
-            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for local matrix chunk");
+    MPI_Datatype row;
+    make_contiguous(row_len, elem, &row);
+    MPI_Scatterv(sendbuf, counts, displs, row,
+                 recvbuf, (int)local_rows, row, root, comm);
+    MPI_Type_free(&row);
+    free(counts);
+    free(displs);
+#endif
+}
+
+/* Gather uneven blocks of rows (row_len doubles each) to root. */
+static void gatherv_rows(const double *sendbuf, long long local_rows, long long row_len,
+                         double *recvbuf, const long long *rowcounts,
+                         const long long *rowdispls, int root, MPI_Comm comm)
+{
+    int rank, p;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &p);
+
+#if MATVEC_LARGE_COUNT
+    MPI_Count *counts = NULL;
+    MPI_Aint  *displs = NULL;
+    if (rank == root) {
+        counts = (MPI_Count *)malloc((size_t)p * sizeof(MPI_Count));
+        displs = (MPI_Aint *)malloc((size_t)p * sizeof(MPI_Aint));
+        if (!counts || !displs) {
+            die_rank0_abort(comm, rank, "out of memory for counts/displacements");
+        }
+        for (int i = 0; i < p; i++) {
+            counts[i] = (MPI_Count)(rowcounts[i] * row_len);
+            displs[i] = (MPI_Aint)(rowdispls[i] * row_len);
+        }
+    }
+    MPI_Gatherv_c(sendbuf, (MPI_Count)(local_rows * row_len), MPI_DOUBLE,
+                  recvbuf, counts, displs, MPI_DOUBLE, root, comm);
+    free(counts);
+    free(displs);
+#else
+    int *counts = NULL;
+    int *displs = NULL;
+    if (rank == root) {
+        counts = (int *)malloc((size_t)p * sizeof(int));
+        displs = (int *)malloc((size_t)p * sizeof(int));
+        if (!counts || !displs) {
+            die_rank0_abort(comm, rank, "out of memory for counts/displacements");
+        }
+        for (int i = 0; i < p; i++) {
+            if (rowdispls[i] + rowcounts[i] > INT_MAX) {
+                die_rank0_abort(comm, rank, "more than INT_MAX rows requires an MPI-4 library");
+            }
+            counts[i] = (int)rowcounts[i];
+            displs[i] = (int)rowdispls[i];
         }
     }
 
-    /* Scatter uneven row blocks of A. */
-    MPI_Scatterv(
-        Afull, sendcountsA, displsA, MPI_DOUBLE,
-        Alocal, local_rows * n, MPI_DOUBLE,
-        0, MPI_COMM_WORLD
-    );
+    MPI_Datatype row;
+    make_contiguous(row_len, MPI_DOUBLE, &row);
+    MPI_Gatherv(sendbuf, (int)local_rows, row,
+                recvbuf, counts, displs, row, root, comm);
+    MPI_Type_free(&row);
+    free(counts);
+    free(displs);
+#endif
+}
 
-    /* Compute local result y_local = A_local * x */
-    double *ylocal = NULL;
-    if (local_rows > 0) {
-        ylocal = (double *)malloc((size_t)local_rows * sizeof(double));
-        if (!ylocal) {
-            free(x);
-            if (rank == 0) free(Afull);
-            free(Alocal);
-            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for local result chunk");
+/* Gather uneven blocks of rows (row_len doubles each) to every rank of comm. */
+static void allgatherv_rows(const double *sendbuf, long long local_rows, long long row_len,
+                            double *recvbuf, const long long *rowcounts,
+                            const long long *rowdispls, MPI_Comm comm)
+{
+    int rank, p;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &p);
+
+#if MATVEC_LARGE_COUNT
+    MPI_Count *counts = (MPI_Count *)malloc((size_t)p * sizeof(MPI_Count));
+    MPI_Aint  *displs = (MPI_Aint *)malloc((size_t)p * sizeof(MPI_Aint));
+    if (!counts || !displs) {
+        die_rank0_abort(comm, rank, "out of memory for counts/displacements");
+    }
+    for (int i = 0; i < p; i++) {
+        counts[i] = (MPI_Count)(rowcounts[i] * row_len);
+        displs[i] = (MPI_Aint)(rowdispls[i] * row_len);
+    }
+    MPI_Allgatherv_c(sendbuf, (MPI_Count)(local_rows * row_len), MPI_DOUBLE,
+                     recvbuf, counts, displs, MPI_DOUBLE, comm);
+    free(counts);
+    free(displs);
+#else
+    int *counts = (int *)malloc((size_t)p * sizeof(int));
+    int *displs = (int *)malloc((size_t)p * sizeof(int));
+    if (!counts || !displs) {
+        die_rank0_abort(comm, rank, "out of memory for counts/displacements");
+    }
+    for (int i = 0; i < p; i++) {
+        if (rowdispls[i] + rowcounts[i] > INT_MAX) {
+            die_rank0_abort(comm, rank, "more than INT_MAX rows requires an MPI-4 library");
         }
+        counts[i] = (int)rowcounts[i];
+        displs[i] = (int)rowdispls[i];
+    }
 
-        for (int i = 0; i < local_rows; i++) {
-            double sum = 0.0;
-            const double *row = &Alocal[(size_t)i * (size_t)n];
-            for (int j = 0; j < n; j++) {
-                sum += row[j] * x[j];
+    MPI_Datatype row;
+    make_contiguous(row_len, MPI_DOUBLE, &row);
+    MPI_Allgatherv(sendbuf, (int)local_rows, row,
+                   recvbuf, counts, displs, row, comm);
+    MPI_Type_free(&row);
+    free(counts);
+    free(displs);
+#endif
+}
+
+/*
+ * Quantized matrix storage (--quant=int8|int16).
+ *
+ * Row i is stored as q[i][j] = round(a[i][j] / s_i) with one fp64 scale
+ * s_i = max_j |a[i][j]| / QMAX per row, so every entry is off by at most s_i / 2.
+ * Rank 0 quantizes once before the scatter; ranks receive 1 or 2 bytes per
+ * entry instead of 8 and dequantize inside the dot product:
+ * y_i = s_i * sum_j q[i][j] * x[j], accumulated in fp64.
+ */
+typedef enum { QUANT_NONE = 0, QUANT_INT8, QUANT_INT16 } QuantKind;
+
+static const char *quant_name(QuantKind kind)
+{
+    switch (kind) {
+    case QUANT_INT8:  return "int8";
+    case QUANT_INT16: return "int16";
+    default:          return "fp64";
+    }
+}
+
+static size_t quant_elem_size(QuantKind kind)
+{
+    return kind == QUANT_INT8 ? sizeof(int8_t) : sizeof(int16_t);
+}
+
+static MPI_Datatype quant_mpi_type(QuantKind kind)
+{
+    return kind == QUANT_INT8 ? MPI_INT8_T : MPI_INT16_T;
+}
+
+/* Quantize m rows of n doubles into Q (int8 or int16) with per-row scales. */
+static void quantize_rows(const double *A, long long m, long long n, QuantKind kind,
+                          void *Q, double *scales)
+{
+    double qmax = (kind == QUANT_INT8) ? 127.0 : 32767.0;
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < m; i++) {
+        const double *row = &A[(size_t)i * (size_t)n];
+        double amax = 0.0;
+        for (size_t j = 0; j < (size_t)n; j++) {
+            double v = fabs(row[j]);
+            if (v > amax) amax = v;
+        }
+
+        double s   = amax / qmax;
+        double inv = (s > 0.0) ? 1.0 / s : 0.0;
+        scales[i] = s;
+
+        for (size_t j = 0; j < (size_t)n; j++) {
+            double v = nearbyint(row[j] * inv);
+            if (v >  qmax) v =  qmax;
+            if (v < -qmax) v = -qmax;
+            if (kind == QUANT_INT8) {
+                ((int8_t *)Q)[(size_t)i * (size_t)n + j] = (int8_t)v;
+            } else {
+                ((int16_t *)Q)[(size_t)i * (size_t)n + j] = (int16_t)v;
             }
-            ylocal[i] = sum;
         }
     }
+}
 
-    /* Gather uneven y chunks to rank 0. */
-    double *y = NULL;
-    if (rank == 0) {
-        y = (double *)malloc((size_t)n * sizeof(double));
-        if (!y) {
-            free(x);
-            free(Afull);
-            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for full result y");
+/*
+ * sum_j q[j] * x[j] for int8 q: widen 16 (AVX-512) or 8 (AVX2) bytes to
+ * int32, convert to double and FMA against x.
+ */
+static double quant_dot_i8(const int8_t *q, const double *x, size_t n)
+{
+    double sum = 0.0;
+    size_t j = 0;
+
+#if defined(__AVX512F__)
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    for (; j + 16 <= n; j += 16) {
+        __m512i w = _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)&q[j]));
+        acc0 = _mm512_fmadd_pd(_mm512_cvtepi32_pd(_mm512_castsi512_si256(w)),
+                               _mm512_loadu_pd(&x[j]), acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(w, 1)),
+                               _mm512_loadu_pd(&x[j + 8]), acc1);
+    }
+    sum = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+#elif defined(__AVX2__) && defined(__FMA__)
+    double tmp[4];
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    for (; j + 8 <= n; j += 8) {
+        __m256i w = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)&q[j]));
+        acc0 = _mm256_fmadd_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(w)),
+                               _mm256_loadu_pd(&x[j]), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(w, 1)),
+                               _mm256_loadu_pd(&x[j + 4]), acc1);
+    }
+    _mm256_storeu_pd(tmp, _mm256_add_pd(acc0, acc1));
+    sum = (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+#endif
+
+    for (; j < n; j++) sum += (double)q[j] * x[j];
+    return sum;
+}
+
+/* Same as quant_dot_i8 for int16 q. */
+static double quant_dot_i16(const int16_t *q, const double *x, size_t n)
+{
+    double sum = 0.0;
+    size_t j = 0;
+
+#if defined(__AVX512F__)
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    for (; j + 16 <= n; j += 16) {
+        __m512i w = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)&q[j]));
+        acc0 = _mm512_fmadd_pd(_mm512_cvtepi32_pd(_mm512_castsi512_si256(w)),
+                               _mm512_loadu_pd(&x[j]), acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(w, 1)),
+                               _mm512_loadu_pd(&x[j + 8]), acc1);
+    }
+    sum = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+#elif defined(__AVX2__) && defined(__FMA__)
+    double tmp[4];
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    for (; j + 8 <= n; j += 8) {
+        __m256i w = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)&q[j]));
+        acc0 = _mm256_fmadd_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(w)),
+                               _mm256_loadu_pd(&x[j]), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(w, 1)),
+                               _mm256_loadu_pd(&x[j + 4]), acc1);
+    }
+    _mm256_storeu_pd(tmp, _mm256_add_pd(acc0, acc1));
+    sum = (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+#endif
+
+    for (; j < n; j++) sum += (double)q[j] * x[j];
+    return sum;
+}
+
+/*
+ * --verify: recompute y = A * x in fp64 on rank 0 from the unquantized
+ * matrix and report the error of the distributed result against it.
+ */
+static void verify_report(const double *A, const double *x, const double *y,
+                          long long m, long long n)
+{
+    double max_err = 0.0;
+    double max_ref = 0.0;
+
+    #pragma omp parallel for schedule(static) reduction(max:max_err, max_ref)
+    for (long long i = 0; i < m; i++) {
+        const double *row = &A[(size_t)i * (size_t)n];
+        double ref = 0.0;
+        for (size_t j = 0; j < (size_t)n; j++) ref += row[j] * x[j];
+
+        double err = fabs(y[i] - ref);
+        if (err > max_err) max_err = err;
+        if (fabs(ref) > max_ref) max_ref = fabs(ref);
+    }
+
+    printf("Verification against fp64: max |y - y_ref| = %.3e, relative (inf-norm) = %.3e\n",
+           max_err, max_ref > 0.0 ? max_err / max_ref : max_err);
+}
+
+/*
+ * Node-shared input vector (--shared-x).
+ *
+ * x is stored once per node in an MPI-3 shared-memory window on the
+ * MPI_COMM_TYPE_SHARED communicator. The node leader (node rank 0) allocates
+ * it, only the leaders take part in the broadcast, and the other ranks of the
+ * node read the leader's copy through the pointer from MPI_Win_shared_query.
+ * The window stays in a lock_all epoch; MPI_Win_sync + a node barrier order
+ * the leader's stores before the other ranks' loads.
+ *
+ * The window memory follows the matvec_alloc rules: the leader over-allocates
+ * by one alignment unit and x starts at the first MATVEC_ALIGN (or, from one
+ * huge page up, HUGE_PAGE_SIZE) boundary of its mapping, the huge-page range
+ * is advised with MADV_HUGEPAGE (for shared memory this also depends on the
+ * kernel's shmem_enabled setting), and the leader's OpenMP threads first-touch
+ * the pages. The other ranks use the same offset into the segment.
+ */
+typedef struct {
+    MPI_Comm node;       /* ranks sharing memory with this one */
+    MPI_Comm leaders;    /* node rank 0 of every node; MPI_COMM_NULL elsewhere */
+    MPI_Win  win;
+    int      nodes;
+} SharedVector;
+
+static double *shared_vector_alloc(long long n, SharedVector *sv)
+{
+    int rank, node_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* key = world rank keeps world rank 0 as node rank 0 and leader rank 0. */
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &sv->node);
+    MPI_Comm_rank(sv->node, &node_rank);
+    MPI_Comm_split(MPI_COMM_WORLD, node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &sv->leaders);
+
+    sv->nodes = 0;
+    if (sv->leaders != MPI_COMM_NULL) MPI_Comm_size(sv->leaders, &sv->nodes);
+    MPI_Bcast(&sv->nodes, 1, MPI_INT, 0, sv->node);
+
+    size_t   want  = (size_t)(n > 0 ? n : 1) * sizeof(double);
+    size_t   align = matvec_align_for(want);
+    char    *base  = NULL;
+    MPI_Aint bytes = (node_rank == 0) ? (MPI_Aint)(want + align) : 0;
+    MPI_Win_allocate_shared(bytes, 1, MPI_INFO_NULL, sv->node, &base, &sv->win);
+
+    long long offset = 0;
+    if (node_rank == 0) {
+        offset = (long long)((align - (uintptr_t)base % align) % align);
+        if (align == HUGE_PAGE_SIZE) advise_huge_pages(base + offset, want);
+        first_touch_rows(base + offset, n, sizeof(double));
+    } else {
+        MPI_Aint size;
+        int      disp_unit;
+        MPI_Win_shared_query(sv->win, 0, &size, &disp_unit, &base);
+    }
+    MPI_Bcast(&offset, 1, MPI_LONG_LONG, 0, sv->node);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, sv->win);
+    return (double *)(base + offset);
+}
+
+/* Leaders broadcast x among themselves; the other ranks wait for their leader. */
+static void shared_vector_bcast(double *x, long long n, SharedVector *sv)
+{
+    if (sv->leaders != MPI_COMM_NULL) {
+        bcast_doubles(x, n, 0, sv->leaders);
+    }
+    MPI_Win_sync(sv->win);
+    MPI_Barrier(sv->node);
+    MPI_Win_sync(sv->win);
+}
+
+static void shared_vector_free(SharedVector *sv)
+{
+    MPI_Win_unlock_all(sv->win);
+    MPI_Win_free(&sv->win);
+    if (sv->leaders != MPI_COMM_NULL) MPI_Comm_free(&sv->leaders);
+    MPI_Comm_free(&sv->node);
+}
+
+/* How A (and with it x and y) is distributed over the ranks. */
+typedef enum { DIST_ROW = 0, DIST_2D, DIST_COL, DIST_AUTO } DistKind;
+
+static const char *dist_name(DistKind kind)
+{
+    switch (kind) {
+    case DIST_2D:   return "2d";
+    case DIST_COL:  return "col";
+    case DIST_AUTO: return "auto";
+    default:        return "row";
+    }
+}
+
+/* How x is broadcast: library MPI_Bcast or a segmented pipeline. */
+typedef enum { BCAST_LIB = 0, BCAST_CHAIN, BCAST_TREE } BcastKind;
+
+/* Where y ends up: gathered on rank 0, replicated on every rank, or left in row blocks. */
+typedef enum { RESULT_ROOT = 0, RESULT_ALL, RESULT_DIST } ResultMode;
+
+static const char *result_name(ResultMode mode)
+{
+    switch (mode) {
+    case RESULT_ALL:  return "allgatherv, y on every rank";
+    case RESULT_DIST: return "distributed, y left in row blocks";
+    default:          return "gatherv to rank 0";
+    }
+}
+
+/* Command line options following <vector_file> <matrix_file>. */
+typedef struct {
+    int repro;
+    int bind;                 /* --bind given */
+    TopoBindPolicy policy;
+    QuantKind quant;
+    int verify;
+    DistKind dist;
+    int shared_x;
+    int overlap;              /* number of pipeline chunks, 0 = off */
+    int rma;                  /* number of MPI_Rget chunks, 0 = scatter */
+    int repeat;               /* --repeat iterations, 0 = single matvec */
+    int power;                /* --power iteration limit, 0 = off */
+    double tol;               /* --power / --cg convergence tolerance */
+    int cg;                   /* --cg iteration limit, 0 = off */
+    int jacobi;               /* --precond=jacobi */
+    int cg_fused;             /* Chronopoulos-Gear variant */
+    int relax;                /* 0 = off, 1 = Jacobi, 2 = two-color block Jacobi */
+    int sweeps;               /* --relax sweep limit */
+    int check_every;          /* sweeps between --relax residual checks */
+    const char *weights;      /* NULL = even rows, "bench" or a profile file */
+    const char *save_weights; /* profile file written after the run, or NULL */
+    ResultMode result;
+    double mem_limit_mb;      /* --dist=auto per-rank storage limit, 0 = none */
+    BcastKind bcast;
+    long long segment;        /* pipeline segment in doubles */
+    int bcast_bench;
+} MatvecOptions;
+
+static int parse_options(int argc, char **argv, MatvecOptions *opt)
+{
+    memset(opt, 0, sizeof *opt);
+    opt->segment = 128 * 1024 / 8;
+    opt->tol = 1e-10;
+    opt->sweeps = 1000;
+    opt->check_every = 10;
+
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--repro") == 0) {
+            opt->repro = 1;
+        } else if (strncmp(argv[i], "--bind=", 7) == 0) {
+            if (topo_parse_policy(argv[i] + 7, &opt->policy) != 0) return -1;
+            opt->bind = 1;
+        } else if (strcmp(argv[i], "--quant=int8") == 0) {
+            opt->quant = QUANT_INT8;
+        } else if (strcmp(argv[i], "--quant=int16") == 0) {
+            opt->quant = QUANT_INT16;
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            opt->verify = 1;
+        } else if (strcmp(argv[i], "--dist=row") == 0) {
+            opt->dist = DIST_ROW;
+        } else if (strcmp(argv[i], "--dist=2d") == 0) {
+            opt->dist = DIST_2D;
+        } else if (strcmp(argv[i], "--dist=col") == 0) {
+            opt->dist = DIST_COL;
+        } else if (strcmp(argv[i], "--dist=auto") == 0) {
+            opt->dist = DIST_AUTO;
+        } else if (strcmp(argv[i], "--bcast=lib") == 0) {
+            opt->bcast = BCAST_LIB;
+        } else if (strcmp(argv[i], "--bcast=chain") == 0) {
+            opt->bcast = BCAST_CHAIN;
+        } else if (strcmp(argv[i], "--bcast=tree") == 0) {
+            opt->bcast = BCAST_TREE;
+        } else if (strncmp(argv[i], "--segment=", 10) == 0) {
+            long long kb = atoll(argv[i] + 10);
+            if (kb < 1 || kb > (long long)INT_MAX / 128) return -1;
+            opt->segment = kb * 1024 / 8;
+        } else if (strcmp(argv[i], "--bcast-bench") == 0) {
+            opt->bcast_bench = 1;
+        } else if (strncmp(argv[i], "--mem-limit=", 12) == 0) {
+            opt->mem_limit_mb = atof(argv[i] + 12);
+            if (!(opt->mem_limit_mb > 0.0)) return -1;
+        } else if (strcmp(argv[i], "--shared-x") == 0) {
+            opt->shared_x = 1;
+        } else if (strcmp(argv[i], "--overlap") == 0) {
+            opt->overlap = 8;
+        } else if (strncmp(argv[i], "--overlap=", 10) == 0) {
+            opt->overlap = atoi(argv[i] + 10);
+            if (opt->overlap < 1) return -1;
+        } else if (strcmp(argv[i], "--rma") == 0) {
+            opt->rma = 8;
+        } else if (strncmp(argv[i], "--rma=", 6) == 0) {
+            opt->rma = atoi(argv[i] + 6);
+            if (opt->rma < 1) return -1;
+        } else if (strncmp(argv[i], "--repeat=", 9) == 0) {
+            opt->repeat = atoi(argv[i] + 9);
+            if (opt->repeat < 1) return -1;
+        } else if (strncmp(argv[i], "--power=", 8) == 0) {
+            opt->power = atoi(argv[i] + 8);
+            if (opt->power < 1) return -1;
+        } else if (strncmp(argv[i], "--cg=", 5) == 0) {
+            opt->cg = atoi(argv[i] + 5);
+            if (opt->cg < 1) return -1;
+        } else if (strcmp(argv[i], "--precond=none") == 0) {
+            opt->jacobi = 0;
+        } else if (strcmp(argv[i], "--precond=jacobi") == 0) {
+            opt->jacobi = 1;
+        } else if (strcmp(argv[i], "--cg-fused") == 0) {
+            opt->cg_fused = 1;
+        } else if (strcmp(argv[i], "--relax=jacobi") == 0) {
+            opt->relax = 1;
+        } else if (strcmp(argv[i], "--relax=twocolor") == 0) {
+            opt->relax = 2;
+        } else if (strncmp(argv[i], "--sweeps=", 9) == 0) {
+            opt->sweeps = atoi(argv[i] + 9);
+            if (opt->sweeps < 1) return -1;
+        } else if (strncmp(argv[i], "--check-every=", 14) == 0) {
+            opt->check_every = atoi(argv[i] + 14);
+            if (opt->check_every < 1) return -1;
+        } else if (strncmp(argv[i], "--tol=", 6) == 0) {
+            opt->tol = atof(argv[i] + 6);
+            if (!(opt->tol >= 0.0)) return -1;
+        } else if (strcmp(argv[i], "--result=root") == 0) {
+            opt->result = RESULT_ROOT;
+        } else if (strcmp(argv[i], "--result=all") == 0) {
+            opt->result = RESULT_ALL;
+        } else if (strcmp(argv[i], "--result=dist") == 0) {
+            opt->result = RESULT_DIST;
+        } else if (strncmp(argv[i], "--weights=", 10) == 0 && argv[i][10] != '\0') {
+            opt->weights = argv[i] + 10;
+        } else if (strncmp(argv[i], "--save-weights=", 15) == 0 && argv[i][15] != '\0') {
+            opt->save_weights = argv[i] + 15;
+        } else {
+            return -1;
         }
     }
 
-    MPI_Gatherv(
-        ylocal, local_rows, MPI_DOUBLE,
-        y, recvcountsY, displsY, MPI_DOUBLE,
-        0, MPI_COMM_WORLD
-    );
+    /* The reproducible summation works on fp64 rows only. */
+    if (opt->repro && opt->quant != QUANT_NONE) return -1;
+    /* Quantized storage is implemented for the row distribution. */
+    if (opt->quant != QUANT_NONE && opt->dist != DIST_ROW) return -1;
+    /* The 2D and column modes never replicate x. */
+    if (opt->shared_x && opt->dist != DIST_ROW) return -1;
+    /* The pipeline streams fp64 rows into private buffers. */
+    if (opt->overlap && (opt->dist != DIST_ROW || opt->quant != QUANT_NONE || opt->shared_x)) return -1;
+    /* One-sided gets read the fp64 rows of A and replace the (pipelined) scatter. */
+    if (opt->rma && (opt->dist != DIST_ROW || opt->quant != QUANT_NONE || opt->overlap)) return -1;
+    /* Repeated steps re-broadcast a private x on the row distribution. */
+    if (opt->repeat && (opt->dist != DIST_ROW || opt->shared_x)) return -1;
+    /* Power iteration overwrites a private x with the allgathered iterate. */
+    if (opt->power && (opt->dist != DIST_ROW || opt->shared_x || opt->repeat)) return -1;
+    /* CG keeps its own distributed vectors; the Jacobi diagonal needs fp64 rows. */
+    if (opt->cg && (opt->dist != DIST_ROW || opt->shared_x || opt->repeat || opt->power ||
+                    opt->quant != QUANT_NONE)) return -1;
+    if ((opt->jacobi || opt->cg_fused) && !opt->cg) return -1;
+    /* Relaxation divides by the fp64 diagonal and keeps its own iterate. */
+    if (opt->relax && (opt->dist != DIST_ROW || opt->shared_x || opt->repeat || opt->power ||
+                       opt->cg || opt->quant != QUANT_NONE)) return -1;
+    /* The 2D and column modes keep their block grids even. */
+    if ((opt->weights || opt->save_weights) && opt->dist != DIST_ROW) return -1;
+    /* A distributed y is never assembled: nothing to verify, and --repeat replicates it. */
+    if (opt->result == RESULT_DIST && (opt->verify || opt->repeat)) return -1;
+    /* The column distribution scatters x; --shared-x broadcasts among node leaders;
+     * the cost model of --dist=auto prices MPI_Bcast and may pick col. */
+    if (opt->bcast != BCAST_LIB &&
+        (opt->dist == DIST_COL || opt->dist == DIST_AUTO || opt->shared_x)) return -1;
+    /* The memory limit only steers the automatic choice. */
+    if (opt->mem_limit_mb > 0.0 && opt->dist != DIST_AUTO) return -1;
+    return 0;
+}
 
-    if (rank == 0) {
-        write_result("Result.txt", y, n);
+/* Uneven block split of total items over parts: counts[i] = q + (i < r). */
+static void block_partition(long long total, int parts, long long *counts, long long *displs)
+{
+    long long q = total / parts;
+    long long r = total % parts;
+    long long disp = 0;
+
+    for (int i = 0; i < parts; i++) {
+        counts[i] = q + (i < r ? 1 : 0);
+        displs[i] = disp;
+        disp += counts[i];
     }
+}
 
-    /* Cleanup */
-    free(x);
-    free(Alocal);
-    free(ylocal);
+/* Broadcast count doubles of x with the --bcast algorithm. */
+static void bcast_x(const MatvecOptions *opt, double *buf, long long count, int root, MPI_Comm comm)
+{
+    if (opt->bcast == BCAST_LIB) {
+        bcast_doubles(buf, count, root, comm);
+    } else {
+        pipelined_bcast(buf, count, opt->segment, opt->bcast == BCAST_TREE, root, comm);
+    }
+}
 
-    if (rank == 0) {
-        free(Afull);
-        free(y);
-        free(sendcountsA);
-        free(displsA);
-        free(recvcountsY);
-        free(displsY);
+/*
+ * Weighted split of total rows over parts: part i gets a share proportional
+ * to weights[i]. Boundaries are the rounded prefix sums of the weights, so
+ * the counts add up to total and equal weights reproduce block_partition
+ * up to where the remainder rows land.
+ */
+static void weighted_partition(long long total, int parts, const double *weights,
+                               long long *counts, long long *displs)
+{
+    double wsum = 0.0;
+    for (int i = 0; i < parts; i++) wsum += weights[i];
+
+    double prefix = 0.0;
+    long long prev = 0;
+    for (int i = 0; i < parts; i++) {
+        prefix += weights[i];
+        long long end = (i + 1 == parts) ? total
+                                         : (long long)((double)total * (prefix / wsum) + 0.5);
+        if (end < prev) end = prev;
+        if (end > total) end = total;
+        displs[i] = prev;
+        counts[i] = end - prev;
+        prev = end;
+    }
+}
+
+/*
+ * Calibration kernel for --weights=bench: plain fp64 row dot products over a
+ * synthetic block of rows of length n (about 8 MB, so it streams from memory
+ * like the real product), timed for at least 50 ms with all OpenMP threads.
+ * Returns multiply-adds per second.
+ */
+static double calibrate_rank_speed(long long n)
+{
+    long long rows = (1LL << 20) / (n > 0 ? n : 1);
+    if (rows < 1) rows = 1;
+
+    double *A = (double *)matvec_alloc((size_t)rows * (size_t)n * sizeof(double));
+    double *x = (double *)matvec_alloc((size_t)n * sizeof(double));
+    double *y = (double *)matvec_alloc((size_t)rows * sizeof(double));
+    if (!A || !x || !y) {
+        matvec_free(A);
+        matvec_free(x);
+        matvec_free(y);
+        return 0.0;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < rows; i++) {
+        for (size_t j = 0; j < (size_t)n; j++) {
+            A[(size_t)i * (size_t)n + j] = 1.0 / (double)(i + (long long)j + 1);
+        }
+    }
+    for (size_t j = 0; j < (size_t)n; j++) x[j] = 1.0;
+
+    volatile double sink = 0.0;
+    long long sweeps = 0;
+    double t0 = MPI_Wtime();
+    double elapsed = 0.0;
+    do {
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < rows; i++) {
+            const double *a = &A[(size_t)i * (size_t)n];
+            double sum = 0.0;
+            for (size_t j = 0; j < (size_t)n; j++) {
+                sum += a[j] * x[j];
+            }
+            y[i] = sum;
+        }
+        sink += y[sweeps % rows];
+        sweeps++;
+        elapsed = MPI_Wtime() - t0;
+    } while (elapsed < 0.05 || sweeps < 3);
+
+    matvec_free(A);
+    matvec_free(x);
+    matvec_free(y);
+    return (double)sweeps * (double)rows * (double)n / elapsed;
+}
+
+/*
+ * Per-rank weights for the row split (--weights), identical on every rank:
+ * "bench" runs calibrate_rank_speed everywhere and allgathers the speeds,
+ * anything else is a profile file read by rank 0 (at least p positive
+ * numbers, e.g. written by --save-weights) and broadcast.
+ */
+static void row_weights(const char *source, long long n, double *weights)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    if (strcmp(source, "bench") == 0) {
+        double speed = calibrate_rank_speed(n);
+        MPI_Allgather(&speed, 1, MPI_DOUBLE, weights, 1, MPI_DOUBLE, MPI_COMM_WORLD);
+    } else {
+        if (rank == 0) {
+            long long count = count_doubles_in_file(source);
+            double *w = (count >= p) ? load_vector(source, (size_t)p) : NULL;
+            if (!w) {
+                die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read weights file (need one weight per rank)");
+            }
+            memcpy(weights, w, (size_t)p * sizeof(double));
+            matvec_free(w);
+        }
+        MPI_Bcast(weights, p, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    }
+
+    for (int k = 0; k < p; k++) {
+        if (!(weights[k] > 0.0) || !isfinite(weights[k])) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "row weights must be positive and finite");
+        }
+    }
+}
+
+/*
+ * Rank 0: write Result.txt, print the compute time and the optional accuracy
+ * report. y is NULL with --result=dist: nothing is written then.
+ */
+static void report_result(const MatvecOptions *opt, const double *Afull, const double *x,
+                          const double *y, long long m, long long n, double t_compute_max)
+{
+    if (y) {
+        write_result("Result.txt", y, (size_t)m, opt->repro);
+    }
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    printf("Local matvec time (max over ranks, %s, %s storage, %d thread(s) per rank): %f seconds\n",
+           opt->repro ? "reproducible" : "plain", quant_name(opt->quant), threads, t_compute_max);
+    if (opt->quant != QUANT_NONE) {
+        size_t qsize = quant_elem_size(opt->quant);
+        printf("Matrix storage per entry: %zu byte(s) + one 8-byte scale per row (%.1fx smaller than fp64)\n",
+               qsize, (8.0 * (double)n) / ((double)qsize * (double)n + 8.0));
+    }
+    if (opt->verify) {
+        verify_report(Afull, x, y, m, n);
+    }
+}
+
+/*
+ * Result placement (--result): rank k of comm holds row block k of y
+ * (counts[k] entries at displs[k]). RESULT_ROOT gathers y on rank 0 of comm,
+ * RESULT_ALL on every rank of comm; both return the full y there (NULL
+ * elsewhere). RESULT_DIST moves nothing and returns NULL: each rank keeps its
+ * block as the input slice of a following step, without the round trip
+ * through rank 0 and Result.txt.
+ */
+static double *place_result(ResultMode mode, const double *ylocal, long long local_rows,
+                            long long m, const long long *counts, const long long *displs,
+                            MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    if (mode == RESULT_DIST) {
+        return NULL;
+    }
+
+    double *y = NULL;
+    if (rank == 0 || mode == RESULT_ALL) {
+        y = (double *)matvec_alloc((size_t)m * sizeof(double));
+        if (!y) {
+            die_rank0_abort(comm, rank, "out of memory for full result y");
+        }
+    }
+    if (mode == RESULT_ALL) {
+        allgatherv_rows(ylocal, local_rows, 1, y, counts, displs, comm);
+    } else {
+        gatherv_rows(ylocal, local_rows, 1, y, counts, displs, 0, comm);
+    }
+    return y;
+}
+
+/*
+ * Rank 0: how y was placed and how long that took (max over ranks, also
+ * returned on rank 0). For a distributed y the squared 2-norm of the blocks
+ * (summed over MPI_COMM_WORLD from ysq, 0 on ranks without a final block)
+ * stands in for Result.txt. Collective over MPI_COMM_WORLD.
+ */
+static double report_placement(ResultMode mode, double t_place, double ysq)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    double t_max = 0.0;
+    double ysq_sum = 0.0;
+    MPI_Reduce(&t_place, &t_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&ysq, &ysq_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        printf("Result placement (%s): %f s (max over ranks)\n", result_name(mode), t_max);
+        if (mode == RESULT_DIST) {
+            printf("y not written to Result.txt; ||y||_2 = %.17g\n", sqrt(ysq_sum));
+        }
+    }
+    return t_max;
+}
+
+/* Sum of squares of a local block of y (for report_placement). */
+static double block_sum_squares(const double *y, long long len)
+{
+    double s = 0.0;
+    for (long long i = 0; i < len; i++) s += y[i] * y[i];
+    return s;
+}
+
+/*
+ * Local row-block product y = A_local * x for the row distribution: fp64
+ * rows (plain or --repro) or quantized rows with per-row scales. Uses the
+ * same static schedule as the first touch of the buffers.
+ */
+static void rows_matvec(const MatvecOptions *opt, const double *Alocal, const void *Qlocal,
+                        const double *slocal, long long local_rows,
+                        const double *x, long long n, double *ylocal)
+{
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < local_rows; i++) {
+        if (opt->quant == QUANT_INT8) {
+            ylocal[i] = slocal[i] * quant_dot_i8((const int8_t *)Qlocal + (size_t)i * (size_t)n,
+                                                 x, (size_t)n);
+            continue;
+        }
+        if (opt->quant == QUANT_INT16) {
+            ylocal[i] = slocal[i] * quant_dot_i16((const int16_t *)Qlocal + (size_t)i * (size_t)n,
+                                                  x, (size_t)n);
+            continue;
+        }
+        const double *row = &Alocal[(size_t)i * (size_t)n];
+        if (opt->repro) {
+            ylocal[i] = repro_dot(row, x, (size_t)n);
+            continue;
+        }
+        double sum = 0.0;
+        for (size_t j = 0; j < (size_t)n; j++) {
+            sum += row[j] * x[j];
+        }
+        ylocal[i] = sum;
+    }
+}
+
+/*
+ * Repeated execution (--repeat=N).
+ *
+ * One step of an iterative method: x is broadcast from rank 0, every rank
+ * computes its rows, and y is allgathered so every rank holds all of it.
+ * The step is run N times with MPI_Bcast / MPI_Allgatherv as a reference,
+ * then N times with MPI-4 persistent collectives (MPI_Bcast_init,
+ * MPI_Allgatherv_init) that are set up once and restarted with MPI_Start,
+ * which saves the per-call setup latency at small n. Libraries older than
+ * MPI-4 (e.g. MS-MPI) only run the reference loop.
+ *
+ * yfull (m doubles) receives y on every rank. times[0] / times[1] are the
+ * blocking / persistent loop times (persistent: -1 when unavailable).
+ */
+static void repeat_iterations(const MatvecOptions *opt, const double *Alocal, const void *Qlocal,
+                              const double *slocal, long long local_rows, double *x,
+                              long long m, long long n, const long long *rowcounts,
+                              const long long *rowdispls, double *ylocal, double *yfull,
+                              double times[2])
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    int *counts = (int *)malloc((size_t)p * sizeof(int));
+    int *displs = (int *)malloc((size_t)p * sizeof(int));
+    if (!counts || !displs) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for counts/displacements");
+    }
+    if (m > INT_MAX) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "--repeat supports at most INT_MAX rows");
+    }
+    for (int k = 0; k < p; k++) {
+        counts[k] = (int)rowcounts[k];
+        displs[k] = (int)rowdispls[k];
+    }
+
+    /* All of x as one element, so the count stays 1 for any n. */
+    MPI_Datatype xtype;
+    make_contiguous(n, MPI_DOUBLE, &xtype);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t = MPI_Wtime();
+    for (int it = 0; it < opt->repeat; it++) {
+        MPI_Bcast(x, 1, xtype, 0, MPI_COMM_WORLD);
+        rows_matvec(opt, Alocal, Qlocal, slocal, local_rows, x, n, ylocal);
+        MPI_Allgatherv(ylocal, (int)local_rows, MPI_DOUBLE,
+                       yfull, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+    }
+    times[0] = MPI_Wtime() - t;
+    times[1] = -1.0;
+
+#if defined(MPI_VERSION) && MPI_VERSION >= 4
+    MPI_Request req[2];
+    MPI_Bcast_init(x, 1, xtype, 0, MPI_COMM_WORLD, MPI_INFO_NULL, &req[0]);
+    MPI_Allgatherv_init(ylocal, (int)local_rows, MPI_DOUBLE,
+                        yfull, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD, MPI_INFO_NULL, &req[1]);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    t = MPI_Wtime();
+    for (int it = 0; it < opt->repeat; it++) {
+        MPI_Start(&req[0]);
+        MPI_Wait(&req[0], MPI_STATUS_IGNORE);
+        rows_matvec(opt, Alocal, Qlocal, slocal, local_rows, x, n, ylocal);
+        MPI_Start(&req[1]);
+        MPI_Wait(&req[1], MPI_STATUS_IGNORE);
+    }
+    times[1] = MPI_Wtime() - t;
+
+    MPI_Request_free(&req[0]);
+    MPI_Request_free(&req[1]);
+#endif
+
+    MPI_Type_free(&xtype);
+    free(counts);
+    free(displs);
+}
+
+/*
+ * Power iteration (--power=N) on the resident row blocks.
+ *
+ * A is scattered once; every iteration then only computes the local rows of
+ * y = A * x, combines ||y||^2 and the Rayleigh quotient x . y (||x|| = 1) in
+ * one MPI_Allreduce of two doubles, and allgathers x = y / ||y|| so every
+ * rank holds the next iterate. lambda = x . A x converges to the dominant
+ * eigenvalue; the loop stops after N iterations or once two successive
+ * estimates differ by at most tol * |lambda|.
+ *
+ * x (n = m doubles, identical on all ranks) is the start vector and receives
+ * the eigenvector estimate. Returns the number of iterations; times[0..2]
+ * are the per-rank totals of local matvec, allreduce and allgatherv,
+ * times[3] / times[4] the fastest / slowest single iteration.
+ */
+static int power_iteration(const MatvecOptions *opt, const double *Alocal, const void *Qlocal,
+                           const double *slocal, long long local_rows, long long first_row,
+                           double *x, long long n, const long long *rowcounts,
+                           const long long *rowdispls, double *ylocal, double *lambda,
+                           int *converged, double times[5])
+{
+    /* Normalize the start vector (same arithmetic on every rank). */
+    double norm = 0.0;
+    for (long long j = 0; j < n; j++) norm += x[j] * x[j];
+    if (norm > 0.0) {
+        norm = sqrt(norm);
+        for (long long j = 0; j < n; j++) x[j] /= norm;
+    } else {
+        for (long long j = 0; j < n; j++) x[j] = 1.0 / sqrt((double)n);
+    }
+
+    double prev = 0.0;
+    int it = 0;
+    *converged = 0;
+    for (int k = 0; k < 5; k++) times[k] = 0.0;
+    times[3] = -1.0;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    while (it < opt->power) {
+        double t0 = MPI_Wtime();
+        rows_matvec(opt, Alocal, Qlocal, slocal, local_rows, x, n, ylocal);
+        double t1 = MPI_Wtime();
+
+        double sums[2] = { 0.0, 0.0 };   /* ||y||^2, x . y */
+        for (long long i = 0; i < local_rows; i++) {
+            sums[0] += ylocal[i] * ylocal[i];
+            sums[1] += x[first_row + i] * ylocal[i];
+        }
+        MPI_Allreduce(MPI_IN_PLACE, sums, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        double t2 = MPI_Wtime();
+
+        it++;
+        *lambda = sums[1];
+        norm = sqrt(sums[0]);
+        if (norm == 0.0) break;            /* x is in the null space of A */
+        for (long long i = 0; i < local_rows; i++) ylocal[i] /= norm;
+        allgatherv_rows(ylocal, local_rows, 1, x, rowcounts, rowdispls, MPI_COMM_WORLD);
+        double t3 = MPI_Wtime();
+
+        times[0] += t1 - t0;
+        times[1] += t2 - t1;
+        times[2] += t3 - t2;
+        if (times[3] < 0.0 || t3 - t0 < times[3]) times[3] = t3 - t0;
+        if (t3 - t0 > times[4]) times[4] = t3 - t0;
+
+        if (it > 1 && fabs(*lambda - prev) <= opt->tol * fabs(*lambda)) {
+            *converged = 1;
+            break;
+        }
+        prev = *lambda;
+    }
+    if (times[3] < 0.0) times[3] = 0.0;
+    return it;
+}
+
+/*
+ * Conjugate gradient solve of A x = b (--cg=N) on the resident row blocks.
+ *
+ * x, r, p, ... are distributed like the rows of A (local_rows entries from
+ * global row first_row); only the vector that A is applied to is allgathered
+ * into the full-length buffer full. Dot products of an iteration are fused
+ * into one MPI_Allreduce each:
+ *  - classic PCG: {p . Ap}, then {r . z, r . r}: two reductions;
+ *  - --cg-fused (Chronopoulos-Gear): s = A p is updated by recurrence from
+ *    w = A z, so {r . z, w . z, r . r} is one reduction per iteration.
+ * With --precond=jacobi z = r / diag(A), otherwise z = r.
+ *
+ * x starts at 0. Stops after N iterations or when ||r|| <= tol * ||b||.
+ * hist (N + 1 entries, may be NULL on ranks other than 0) receives ||r|| per
+ * iteration. Returns the iteration count; times[0..2] are the per-rank
+ * totals of local matvec, allreduce and allgatherv time inside the loop,
+ * times[3] the loop itself. The setup before the loop (initial reduction,
+ * plus the first allgatherv and matvec of --cg-fused) is in none of them.
+ */
+static int cg_solve(const MatvecOptions *opt, const double *Alocal, long long local_rows,
+                    long long first_row, const double *bfull, long long n,
+                    const long long *rowcounts, const long long *rowdispls,
+                    double *xsol, double *hist, double *full, double times[4])
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    size_t bytes = (size_t)(local_rows > 0 ? local_rows : 1) * sizeof(double);
+    double *r    = (double *)matvec_alloc(bytes);
+    double *z    = (double *)matvec_alloc(bytes);
+    double *pv   = (double *)matvec_alloc(bytes);
+    double *q    = (double *)matvec_alloc(bytes);   /* A p (classic) or s = A p (fused) */
+    double *w    = (double *)matvec_alloc(bytes);   /* A z (fused) */
+    double *dinv = (double *)matvec_alloc(bytes);
+    if (!r || !z || !pv || !q || !w || !dinv) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for CG vectors");
+    }
+
+    for (long long i = 0; i < local_rows; i++) {
+        double d = Alocal[(size_t)i * (size_t)n + (size_t)(first_row + i)];
+        if (opt->jacobi && d == 0.0) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "--precond=jacobi needs a nonzero diagonal");
+        }
+        dinv[i] = opt->jacobi ? 1.0 / d : 1.0;
+        xsol[i] = 0.0;
+        r[i]    = bfull[first_row + i];
+        z[i]    = dinv[i] * r[i];
+        pv[i]   = 0.0;
+        q[i]    = 0.0;
+    }
+
+    /* Fused variant: w = A z up front. */
+    if (opt->cg_fused) {
+        allgatherv_rows(z, local_rows, 1, full, rowcounts, rowdispls, MPI_COMM_WORLD);
+        rows_matvec(opt, Alocal, NULL, NULL, local_rows, full, n, w);
+    }
+
+    /* {r . z, w . z, r . r}; w . z only for the fused variant. */
+    double d3[3] = { 0.0, 0.0, 0.0 };
+    for (long long i = 0; i < local_rows; i++) {
+        d3[0] += r[i] * z[i];
+        d3[1] += opt->cg_fused ? w[i] * z[i] : 0.0;
+        d3[2] += r[i] * r[i];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, d3, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    double bnorm = sqrt(d3[2]);
+    double rnorm = bnorm;
+    double rho   = d3[0];        /* r . z */
+    double delta = d3[1];        /* w . z */
+    double rho_prev = 0.0;
+    double alpha = 0.0;
+    if (hist) hist[0] = bnorm;
+
+    /* Phase timers cover the loop only, like times[3]. */
+    double t_mv = 0.0, t_red = 0.0, t_gat = 0.0;
+    double t;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_loop = MPI_Wtime();
+    int it = 0;
+    while (it < opt->cg && rnorm > opt->tol * bnorm) {
+        if (opt->cg_fused) {
+            /* beta from the previous step, alpha from delta without a second reduction. */
+            double beta = (it == 0) ? 0.0 : rho / rho_prev;
+            double denom = (it == 0) ? delta : delta - beta * rho / alpha;
+            if (!(denom > 0.0)) {
+                die_rank0_abort(MPI_COMM_WORLD, rank, "CG breakdown: matrix is not positive definite");
+            }
+            alpha = rho / denom;
+            for (long long i = 0; i < local_rows; i++) {
+                pv[i]    = z[i] + beta * pv[i];
+                q[i]     = w[i] + beta * q[i];       /* s = A p */
+                xsol[i] += alpha * pv[i];
+                r[i]    -= alpha * q[i];
+                z[i]     = dinv[i] * r[i];
+            }
+
+            t = MPI_Wtime();
+            allgatherv_rows(z, local_rows, 1, full, rowcounts, rowdispls, MPI_COMM_WORLD);
+            t_gat += MPI_Wtime() - t;
+            t = MPI_Wtime();
+            rows_matvec(opt, Alocal, NULL, NULL, local_rows, full, n, w);
+            t_mv += MPI_Wtime() - t;
+
+            d3[0] = d3[1] = d3[2] = 0.0;
+            for (long long i = 0; i < local_rows; i++) {
+                d3[0] += r[i] * z[i];
+                d3[1] += w[i] * z[i];
+                d3[2] += r[i] * r[i];
+            }
+            t = MPI_Wtime();
+            MPI_Allreduce(MPI_IN_PLACE, d3, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            t_red += MPI_Wtime() - t;
+            rho_prev = rho;
+            rho   = d3[0];
+            delta = d3[1];
+        } else {
+            double beta = (it == 0) ? 0.0 : rho / rho_prev;
+            for (long long i = 0; i < local_rows; i++) {
+                pv[i] = z[i] + beta * pv[i];
+            }
+
+            t = MPI_Wtime();
+            allgatherv_rows(pv, local_rows, 1, full, rowcounts, rowdispls, MPI_COMM_WORLD);
+            t_gat += MPI_Wtime() - t;
+            t = MPI_Wtime();
+            rows_matvec(opt, Alocal, NULL, NULL, local_rows, full, n, q);
+            t_mv += MPI_Wtime() - t;
+
+            double pq = 0.0;
+            for (long long i = 0; i < local_rows; i++) pq += pv[i] * q[i];
+            t = MPI_Wtime();
+            MPI_Allreduce(MPI_IN_PLACE, &pq, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            t_red += MPI_Wtime() - t;
+            if (!(pq > 0.0)) {
+                die_rank0_abort(MPI_COMM_WORLD, rank, "CG breakdown: matrix is not positive definite");
+            }
+            alpha = rho / pq;
+
+            double d2[2] = { 0.0, 0.0 };
+            for (long long i = 0; i < local_rows; i++) {
+                xsol[i] += alpha * pv[i];
+                r[i]    -= alpha * q[i];
+                z[i]     = dinv[i] * r[i];
+                d2[0]   += r[i] * z[i];
+                d2[1]   += r[i] * r[i];
+            }
+            t = MPI_Wtime();
+            MPI_Allreduce(MPI_IN_PLACE, d2, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            t_red += MPI_Wtime() - t;
+            rho_prev = rho;
+            rho   = d2[0];
+            d3[2] = d2[1];
+        }
+        it++;
+        rnorm = sqrt(d3[2]);
+        if (hist) hist[it] = rnorm;
+    }
+
+    times[0] = t_mv;
+    times[1] = t_red;
+    times[2] = t_gat;
+    times[3] = MPI_Wtime() - t_loop;
+
+    matvec_free(r);
+    matvec_free(z);
+    matvec_free(pv);
+    matvec_free(q);
+    matvec_free(w);
+    matvec_free(dinv);
+    return it;
+}
+
+/*
+ * One relaxation pass over the local rows: for rows whose global index has
+ * parity color (all rows when color < 0)
+ *   xnew_i = (b_i - sum_{j != i} a_ij x_j) / a_ii
+ * from the full current iterate x; the other rows copy x_i.
+ */
+static void relax_rows(const double *Alocal, long long local_rows, long long first_row,
+                       long long n, const double *b, const double *x, double *xnew, int color)
+{
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < local_rows; i++) {
+        long long g = first_row + i;
+        if (color >= 0 && (int)(g & 1) != color) {
+            xnew[i] = x[g];
+            continue;
+        }
+        const double *row = &Alocal[(size_t)i * (size_t)n];
+        double sum = 0.0;
+        for (size_t j = 0; j < (size_t)n; j++) {
+            sum += row[j] * x[j];
+        }
+        double aii = row[g];
+        xnew[i] = (b[g] - (sum - aii * x[g])) / aii;
+    }
+}
+
+/*
+ * Stationary relaxation for A x = b (--relax) on the resident row blocks.
+ *
+ * Every rank holds the full iterate x and updates its own rows:
+ *  - Jacobi: all rows from the previous iterate, one MPI_Allgatherv per sweep;
+ *  - two-color block Jacobi: even rows first, allgather, then odd rows from
+ *    the new even values, allgather (two exchanges per sweep). Parity is a
+ *    true red-black ordering only for tridiagonal A; in a dense A the rows of
+ *    one color are coupled, so each half-sweep is a Jacobi step on that
+ *    color (Gauss-Seidel only between the two blocks).
+ * The residual ||b - A x|| costs a local matvec and one MPI_Allreduce, so it
+ * is only formed every check_every sweeps (and after the last one).
+ *
+ * x (n doubles) starts at 0 and receives the solution; xnew and r are
+ * local_rows scratch vectors. Returns the number of sweeps; *relres is the
+ * last checked ||r|| / ||b||, *checks the number of checks. times[0..3] are
+ * the per-rank totals of sweep compute, allgatherv, residual checks and the
+ * whole loop.
+ */
+static int relax_solve(const MatvecOptions *opt, const double *Alocal, long long local_rows,
+                       long long first_row, const double *b, long long n,
+                       const long long *rowcounts, const long long *rowdispls,
+                       double *x, double *xnew, double *r, double *relres, int *checks,
+                       double times[4])
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    for (long long i = 0; i < local_rows; i++) {
+        if (Alocal[(size_t)i * (size_t)n + (size_t)(first_row + i)] == 0.0) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "--relax needs a nonzero diagonal");
+        }
+    }
+
+    double bnorm = 0.0;
+    for (long long j = 0; j < n; j++) {
+        bnorm += b[j] * b[j];
+        x[j] = 0.0;
+    }
+    bnorm = sqrt(bnorm);
+
+    double t_sweep = 0.0, t_gat = 0.0, t_chk = 0.0, t;
+    int sweep = 0;
+    *checks = 0;
+    *relres = 1.0;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_loop = MPI_Wtime();
+    while (sweep < opt->sweeps) {
+        int colors = (opt->relax == 2) ? 2 : 1;
+        for (int c = 0; c < colors; c++) {
+            t = MPI_Wtime();
+            relax_rows(Alocal, local_rows, first_row, n, b, x, xnew, colors == 2 ? c : -1);
+            t_sweep += MPI_Wtime() - t;
+            t = MPI_Wtime();
+            allgatherv_rows(xnew, local_rows, 1, x, rowcounts, rowdispls, MPI_COMM_WORLD);
+            t_gat += MPI_Wtime() - t;
+        }
+        sweep++;
+
+        if (sweep % opt->check_every == 0 || sweep == opt->sweeps) {
+            t = MPI_Wtime();
+            rows_matvec(opt, Alocal, NULL, NULL, local_rows, x, n, r);
+            double rr = 0.0;
+            for (long long i = 0; i < local_rows; i++) {
+                double d = b[first_row + i] - r[i];
+                rr += d * d;
+            }
+            MPI_Allreduce(MPI_IN_PLACE, &rr, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            t_chk += MPI_Wtime() - t;
+            (*checks)++;
+            *relres = (bnorm > 0.0) ? sqrt(rr) / bnorm : sqrt(rr);
+            if (*relres <= opt->tol) break;
+        }
+    }
+
+    times[0] = t_sweep;
+    times[1] = t_gat;
+    times[2] = t_chk;
+    times[3] = MPI_Wtime() - t_loop;
+    return sweep;
+}
+
+/*
+ * Completion bookkeeping for the --overlap pipeline: done[i] marks request i
+ * as finished and *t_last is the latest time one was seen to finish.
+ */
+static void pipeline_wait(MPI_Request *req, char *done, double *t_last)
+{
+    if (*done) return;
+    MPI_Wait(req, MPI_STATUS_IGNORE);
+    *done = 1;
+    *t_last = MPI_Wtime();
+}
+
+static void pipeline_poll(MPI_Request *req, char *done, int count, double *t_last)
+{
+    for (int i = 0; i < count; i++) {
+        if (done[i]) continue;
+        int flag = 0;
+        MPI_Test(&req[i], &flag, MPI_STATUS_IGNORE);
+        if (flag) {
+            done[i] = 1;
+            *t_last = MPI_Wtime();
+        }
+    }
+}
+
+/*
+ * Pipelined distribution (--overlap=K).
+ *
+ * x is broadcast as K column segments (MPI_Ibcast each) and every rank's row
+ * block of A arrives as K row chunks (one MPI_Iscatterv per chunk, counted in
+ * rows of a row datatype). All 2K requests are posted at once, then chunk c
+ * is computed as soon as it has landed: the first chunk consumes x segment
+ * by segment while the rest of x is still in flight, the following chunks
+ * overlap with the remaining scatters. Accumulating segment-wise keeps the
+ * plain summation order, so y is bitwise the same as without --overlap.
+ * With --repro rows are only summed once all of x is there.
+ *
+ * Between computations every outstanding request is polled with MPI_Test,
+ * so the communication span (posting to the last completion) is measured
+ * inside the pipeline; a completion is only seen at the next poll, which
+ * rounds the span up by at most one chunk or segment of compute.
+ *
+ * times[0] = pipeline wall time, times[1] = time blocked in MPI_Wait,
+ * times[2] = compute time, times[3] = communication span. Hidden
+ * communication is times[3] - times[1]. Afull/rowcounts/rowdispls are
+ * significant on root.
+ */
+static void overlap_pipeline(const double *Afull, const long long *rowcounts,
+                             const long long *rowdispls, double *x, long long n,
+                             double *Alocal, double *ylocal, long long local_rows,
+                             int chunks, int repro, double times[4])
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    long long    *ccount  = (long long *)malloc((size_t)chunks * sizeof(long long));
+    long long    *cdispl  = (long long *)malloc((size_t)chunks * sizeof(long long));
+    long long    *xcount  = (long long *)malloc((size_t)chunks * sizeof(long long));
+    long long    *xdispl  = (long long *)malloc((size_t)chunks * sizeof(long long));
+    MPI_Request  *xreq    = (MPI_Request *)malloc(2 * (size_t)chunks * sizeof(MPI_Request));
+    char         *xdone   = (char *)calloc(2 * (size_t)chunks, 1);
+    MPI_Datatype *segtype = (MPI_Datatype *)malloc((size_t)chunks * sizeof(MPI_Datatype));
+    if (!ccount || !cdispl || !xcount || !xdispl || !xreq || !xdone || !segtype) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for pipeline requests");
+    }
+    /* x segment requests first, then the matrix chunks (polled as one array). */
+    MPI_Request *areq  = xreq + chunks;
+    char        *adone = xdone + chunks;
+    block_partition(local_rows, chunks, ccount, cdispl);   /* my row chunks */
+    block_partition(n, chunks, xcount, xdispl);            /* x segments */
+
+    /* Root: send counts/displacements (in rows) of chunk c for every rank. */
+    int *scounts = NULL;
+    int *sdispls = NULL;
+    if (rank == 0) {
+        scounts = (int *)malloc((size_t)chunks * (size_t)p * sizeof(int));
+        sdispls = (int *)malloc((size_t)chunks * (size_t)p * sizeof(int));
+        long long *kc = (long long *)malloc((size_t)chunks * sizeof(long long));
+        long long *kd = (long long *)malloc((size_t)chunks * sizeof(long long));
+        if (!scounts || !sdispls || !kc || !kd) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for pipeline counts");
+        }
+        for (int k = 0; k < p; k++) {
+            if (rowdispls[k] + rowcounts[k] > INT_MAX) {
+                die_rank0_abort(MPI_COMM_WORLD, rank, "--overlap supports at most INT_MAX rows");
+            }
+            block_partition(rowcounts[k], chunks, kc, kd);
+            for (int c = 0; c < chunks; c++) {
+                scounts[(size_t)c * p + k] = (int)kc[c];
+                sdispls[(size_t)c * p + k] = (int)(rowdispls[k] + kd[c]);
+            }
+        }
+        free(kc);
+        free(kd);
+    }
+
+    MPI_Datatype row;
+    make_contiguous(n, MPI_DOUBLE, &row);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_start = MPI_Wtime();
+
+    /* Post everything: x segments first, they are needed by every chunk. */
+    for (int c = 0; c < chunks; c++) {
+        make_contiguous(xcount[c], MPI_DOUBLE, &segtype[c]);
+        MPI_Ibcast(&x[xdispl[c]], 1, segtype[c], 0, MPI_COMM_WORLD, &xreq[c]);
+    }
+    for (int c = 0; c < chunks; c++) {
+        MPI_Iscatterv(Afull, rank == 0 ? &scounts[(size_t)c * p] : NULL,
+                      rank == 0 ? &sdispls[(size_t)c * p] : NULL, row,
+                      &Alocal[(size_t)cdispl[c] * (size_t)n], (int)ccount[c], row,
+                      0, MPI_COMM_WORLD, &areq[c]);
+    }
+
+    double t_wait = 0.0;
+    double t_comp = 0.0;
+    double t_last = t_start;   /* latest observed completion */
+    int x_ready = 0;           /* x segments [0, x_ready) have arrived */
+
+    for (int c = 0; c < chunks; c++) {
+        double t = MPI_Wtime();
+        pipeline_wait(&areq[c], &adone[c], &t_last);
+        if (repro) {
+            for (; x_ready < chunks; x_ready++) pipeline_wait(&xreq[x_ready], &xdone[x_ready], &t_last);
+        }
+        t_wait += MPI_Wtime() - t;
+
+        const double *A = &Alocal[(size_t)cdispl[c] * (size_t)n];
+        double *yc = &ylocal[cdispl[c]];
+        long long rows = ccount[c];
+
+        if (repro) {
+            t = MPI_Wtime();
+            #pragma omp parallel for schedule(static)
+            for (long long i = 0; i < rows; i++) {
+                yc[i] = repro_dot(&A[(size_t)i * (size_t)n], x, (size_t)n);
+            }
+            t_comp += MPI_Wtime() - t;
+            pipeline_poll(xreq, xdone, 2 * chunks, &t_last);
+            continue;
+        }
+
+        for (long long i = 0; i < rows; i++) yc[i] = 0.0;
+        for (int sgm = 0; sgm < chunks; sgm++) {
+            if (sgm >= x_ready) {
+                t = MPI_Wtime();
+                pipeline_wait(&xreq[sgm], &xdone[sgm], &t_last);
+                t_wait += MPI_Wtime() - t;
+                x_ready = sgm + 1;
+            }
+            while (x_ready < chunks && xdone[x_ready]) x_ready++;
+
+            /* Once all of x is there, the rest of the row is one sweep. */
+            size_t j0 = (size_t)xdispl[sgm];
+            size_t j1 = (x_ready == chunks) ? (size_t)n : j0 + (size_t)xcount[sgm];
+            t = MPI_Wtime();
+            #pragma omp parallel for schedule(static)
+            for (long long i = 0; i < rows; i++) {
+                const double *a = &A[(size_t)i * (size_t)n];
+                double sum = yc[i];
+                for (size_t j = j0; j < j1; j++) {
+                    sum += a[j] * x[j];
+                }
+                yc[i] = sum;
+            }
+            t_comp += MPI_Wtime() - t;
+            pipeline_poll(xreq, xdone, 2 * chunks, &t_last);
+            if (j1 == (size_t)n) break;
+        }
+    }
+    /* Ranks without rows still have to complete their x segments. */
+    double t = MPI_Wtime();
+    for (int c = 0; c < chunks; c++) pipeline_wait(&xreq[c], &xdone[c], &t_last);
+    t_wait += MPI_Wtime() - t;
+
+    times[0] = MPI_Wtime() - t_start;
+    times[1] = t_wait;
+    times[2] = t_comp;
+    times[3] = t_last - t_start;
+
+    for (int c = 0; c < chunks; c++) MPI_Type_free(&segtype[c]);
+    MPI_Type_free(&row);
+    free(ccount);
+    free(cdispl);
+    free(xcount);
+    free(xdispl);
+    free(xreq);
+    free(xdone);
+    free(segtype);
+    free(scounts);
+    free(sdispls);
+}
+
+/*
+ * One-sided distribution (--rma=K).
+ *
+ * Rank 0 exposes Afull in an MPI window (the other ranks expose nothing) and
+ * every rank pulls its own row block with K MPI_Rget requests under a shared
+ * passive-target lock, so root only answers gets and never drives a
+ * collective. Chunk c is computed as soon as its MPI_Rget has completed while
+ * the later chunks are still in flight. Apart from creating and freeing the
+ * window the ranks never wait for each other: a rank with a fast link
+ * finishes its rows without waiting for the slow ones. Rows are summed as in
+ * rows_matvec, so y is bitwise the same as with the scatter.
+ *
+ * times[0] = fetch + compute wall time, times[1] = time blocked in MPI_Wait,
+ * times[2] = compute time. Afull is significant on rank 0 only.
+ */
+static void rma_fetch_rows(const MatvecOptions *opt, double *Afull, long long m, long long n,
+                           long long first_row, long long local_rows, double *Alocal,
+                           const double *x, double *ylocal, int chunks, double times[3])
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    long long   *ccount = (long long *)malloc((size_t)chunks * sizeof(long long));
+    long long   *cdispl = (long long *)malloc((size_t)chunks * sizeof(long long));
+    MPI_Request *req    = (MPI_Request *)malloc((size_t)chunks * sizeof(MPI_Request));
+    if (!ccount || !cdispl || !req) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for RMA requests");
+    }
+    if (local_rows > INT_MAX) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "--rma supports at most INT_MAX rows per rank");
+    }
+    block_partition(local_rows, chunks, ccount, cdispl);
+
+    /* Displacements are counted in doubles. */
+    MPI_Win win;
+    MPI_Aint win_bytes = (rank == 0) ? (MPI_Aint)m * (MPI_Aint)n * (MPI_Aint)sizeof(double) : 0;
+    MPI_Win_create(rank == 0 ? Afull : NULL, win_bytes, (int)sizeof(double),
+                   MPI_INFO_NULL, MPI_COMM_WORLD, &win);
+
+    MPI_Datatype row;
+    make_contiguous(n, MPI_DOUBLE, &row);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_start = MPI_Wtime();
+
+    MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, win);
+    for (int c = 0; c < chunks; c++) {
+        MPI_Rget(&Alocal[(size_t)cdispl[c] * (size_t)n], (int)ccount[c], row,
+                 0, (MPI_Aint)(first_row + cdispl[c]) * (MPI_Aint)n, (int)ccount[c], row,
+                 win, &req[c]);
+    }
+
+    double t_wait = 0.0;
+    double t_comp = 0.0;
+    for (int c = 0; c < chunks; c++) {
+        double t = MPI_Wtime();
+        MPI_Wait(&req[c], MPI_STATUS_IGNORE);
+        t_wait += MPI_Wtime() - t;
+
+        t = MPI_Wtime();
+        rows_matvec(opt, &Alocal[(size_t)cdispl[c] * (size_t)n], NULL, NULL, ccount[c],
+                    x, n, &ylocal[cdispl[c]]);
+        t_comp += MPI_Wtime() - t;
+    }
+    MPI_Win_unlock(0, win);
+
+    times[0] = MPI_Wtime() - t_start;
+    times[1] = t_wait;
+    times[2] = t_comp;
+
+    /* Collective: rank 0 keeps Afull exposed until every rank is done. */
+    MPI_Win_free(&win);
+    MPI_Type_free(&row);
+    free(ccount);
+    free(cdispl);
+    free(req);
+}
+
+/*
+ * Row-block distribution (--dist=row, default): rank i owns rows_i full rows
+ * of A and receives all of x. Rows are split evenly or, with --weights, in
+ * proportion to per-rank speed so that ranks finish at the same time.
+ * Returns (on rank 0) the sum of the per-phase maxima of A scatter, x
+ * broadcast, local matvec and result placement, the phases the cost model
+ * of --dist=auto predicts.
+ */
+static double run_rows(const char *vec_file, const char *mat_file, long long m, long long n,
+                     const MatvecOptions *opt)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    /*
+     * Row counts/displacements for Scatterv/Gatherv, known on every rank:
+     * rows_i = q + (i < r), or proportional to the per-rank weights.
+     */
+    long long *rowcounts = (long long *)malloc((size_t)p * sizeof(long long));
+    long long *rowdispls = (long long *)malloc((size_t)p * sizeof(long long));
+    double    *weights   = (double *)malloc((size_t)p * sizeof(double));
+    if (!rowcounts || !rowdispls || !weights) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for counts/displacements");
+    }
+
+    /* matrix chunk: rows_i rows of n cols; y chunk: rows_i entries */
+    if (opt->weights) {
+        row_weights(opt->weights, n, weights);
+        weighted_partition(m, p, weights, rowcounts, rowdispls);
+    } else {
+        block_partition(m, p, rowcounts, rowdispls);
+    }
+    long long local_rows = rowcounts[rank];
+
+    /* Allocate and load x (broadcast to all; with --shared-x one copy per node). */
+    SharedVector sv;
+    double *x = opt->shared_x ? shared_vector_alloc(n, &sv)
+                              : (double *)matvec_alloc((size_t)n * sizeof(double));
+    if (!x) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for vector x");
+    }
+
+    if (rank == 0) {
+        double *tmp = load_vector(vec_file, (size_t)n);
+        if (!tmp) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read vector file (format/size mismatch)");
+        }
+        memcpy(x, tmp, (size_t)n * sizeof(double));
+        matvec_free(tmp);
+    }
+
+    /* --overlap: x travels in the pipeline below. */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_x = MPI_Wtime();
+    if (opt->overlap) {
+        /* Nothing to send yet. */
+    } else if (opt->shared_x) {
+        shared_vector_bcast(x, n, &sv);
+    } else {
+        bcast_x(opt, x, n, 0, MPI_COMM_WORLD);
+    }
+    t_x = MPI_Wtime() - t_x;
+
+    /* Rank 0 loads full matrix A; others keep NULL. */
+    double *Afull = NULL;
+    if (rank == 0) {
+        Afull = load_matrix(mat_file, (size_t)m, (size_t)n);
+        if (!Afull) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read matrix file (format/size mismatch)");
+        }
+    }
+
+    /* Rank 0 quantizes the full matrix once (Afull is kept for --verify). */
+    void   *Qfull = NULL;
+    double *sfull = NULL;
+    size_t  qsize = (opt->quant != QUANT_NONE) ? quant_elem_size(opt->quant) : sizeof(double);
+    if (rank == 0 && opt->quant != QUANT_NONE) {
+        Qfull = matvec_alloc((size_t)m * (size_t)n * qsize);
+        sfull = (double *)matvec_alloc((size_t)m * sizeof(double));
+        if (!Qfull || !sfull) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for quantized matrix");
+        }
+        quantize_rows(Afull, m, n, opt->quant, Qfull, sfull);
+    }
+
+    /*
+     * Allocate the local matrix chunk (local_rows * n entries, fp64 or quantized
+     * plus one scale per row) and result chunk; place pages by first touch.
+     */
+    double *Alocal = NULL;
+    void   *Qlocal = NULL;
+    double *slocal = NULL;
+    double *ylocal = NULL;
+    if (local_rows > 0) {
+        if (opt->quant != QUANT_NONE) {
+            Qlocal = matvec_alloc((size_t)local_rows * (size_t)n * qsize);
+            slocal = (double *)matvec_alloc((size_t)local_rows * sizeof(double));
+        } else {
+            Alocal = (double *)matvec_alloc((size_t)local_rows * (size_t)n * sizeof(double));
+        }
+        ylocal = (double *)matvec_alloc((size_t)local_rows * sizeof(double));
+        if ((opt->quant != QUANT_NONE ? (!Qlocal || !slocal) : !Alocal) || !ylocal) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for local matrix chunk");
+        }
+        first_touch_rows(opt->quant != QUANT_NONE ? Qlocal : (void *)Alocal,
+                         local_rows, (size_t)n * qsize);
+        if (slocal) first_touch_rows(slocal, local_rows, sizeof(double));
+        first_touch_rows(ylocal, local_rows, sizeof(double));
+    }
+
+    /*
+     * Scatter uneven row blocks of A (quantized: entries and per-row scales).
+     * The barrier keeps rank 0's file loading out of the scatter time.
+     */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_scatter = MPI_Wtime();
+    if (opt->rma || opt->overlap) {
+        /* --rma: every rank pulls its own rows; --overlap: pipelined below. */
+    } else if (opt->quant != QUANT_NONE) {
+        scatterv_rows(Qfull, rowcounts, rowdispls, n, quant_mpi_type(opt->quant),
+                      Qlocal, local_rows, 0, MPI_COMM_WORLD);
+        scatterv_rows(sfull, rowcounts, rowdispls, 1, MPI_DOUBLE,
+                      slocal, local_rows, 0, MPI_COMM_WORLD);
+    } else {
+        scatterv_rows(Afull, rowcounts, rowdispls, n, MPI_DOUBLE,
+                      Alocal, local_rows, 0, MPI_COMM_WORLD);
+    }
+    t_scatter = MPI_Wtime() - t_scatter;
+
+    /*
+     * --overlap: x and A are sent only once, by the pipeline, which computes
+     * while they arrive and measures how long the transfers took.
+     */
+    double t_pipe[4] = { 0.0, 0.0, 0.0, 0.0 };
+    if (opt->overlap) {
+        overlap_pipeline(Afull, rowcounts, rowdispls, x, n, Alocal, ylocal, local_rows,
+                         opt->overlap, opt->repro, t_pipe);
+    }
+
+    /* --rma: one-sided gets of my rows, computed chunk by chunk. */
+    double t_rma[3] = { 0.0, 0.0, 0.0 };
+    if (opt->rma) {
+        rma_fetch_rows(opt, Afull, m, n, rowdispls[rank], local_rows,
+                       Alocal, x, ylocal, opt->rma, t_rma);
+    }
+
+    /* Compute local result y_local = A_local * x. */
+    double t_compute = MPI_Wtime();
+    if (!opt->overlap && !opt->rma) {
+        rows_matvec(opt, Alocal, Qlocal, slocal, local_rows, x, n, ylocal);
+    }
+
+    /* Slowest rank's compute time, so the cost of --repro / --quant can be measured. */
+    t_compute = opt->overlap ? t_pipe[2] : opt->rma ? t_rma[2] : MPI_Wtime() - t_compute;
+    double t_local[7] = { t_compute, t_x, t_scatter, t_pipe[0], t_pipe[1], t_rma[0], t_rma[1] };
+    double t_max[7]   = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    double t_min[2]   = { 0.0, 0.0 };
+    MPI_Reduce(t_local, t_max, 7, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&t_local[5], &t_min[0], 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&t_local[0], &t_min[1], 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+
+    /* --overlap: hidden = communication span - exposed wait, per rank. */
+    double t_hidden[2] = { 0.0, 0.0 };   /* seconds, fraction of the span */
+    double t_span = 0.0;
+    double t_hidden_min[2] = { 0.0, 0.0 };
+    if (opt->overlap) {
+        t_hidden[0] = (t_pipe[3] > t_pipe[1]) ? t_pipe[3] - t_pipe[1] : 0.0;
+        t_hidden[1] = (t_pipe[3] > 0.0) ? t_hidden[0] / t_pipe[3] : 0.0;
+        MPI_Reduce(&t_pipe[3], &t_span, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(t_hidden, t_hidden_min, 2, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+    }
+
+    /*
+     * --save-weights: this run's throughput (multiply-adds per second of the
+     * local product) per rank. Ranks without rows get the slowest measured one.
+     */
+    double speed = (local_rows > 0 && t_compute > 0.0)
+                 ? (double)local_rows * (double)n / t_compute : 0.0;
+    if (opt->save_weights) {
+        MPI_Gather(&speed, 1, MPI_DOUBLE, weights, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            double slowest = 0.0;
+            for (int k = 0; k < p; k++) {
+                if (weights[k] > 0.0 && (slowest == 0.0 || weights[k] < slowest)) slowest = weights[k];
+            }
+            for (int k = 0; k < p; k++) {
+                if (!(weights[k] > 0.0)) weights[k] = (slowest > 0.0) ? slowest : 1.0;
+            }
+            write_result(opt->save_weights, weights, (size_t)p, 0);
+        }
+    }
+
+    /* Place the uneven y chunks (--repeat: allgathered on every rank in each step). */
+    double *y = NULL;
+    double t_rep[2] = { 0.0, -1.0 };
+    double t_place = 0.0;
+    if (opt->repeat) {
+        y = (double *)matvec_alloc((size_t)m * sizeof(double));
+        if (!y) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for full result y");
+        }
+        repeat_iterations(opt, Alocal, Qlocal, slocal, local_rows, x, m, n, rowcounts, rowdispls,
+                          ylocal, y, t_rep);
+    } else {
+        MPI_Barrier(MPI_COMM_WORLD);
+        t_place = MPI_Wtime();
+        y = place_result(opt->result, ylocal, local_rows, m, rowcounts, rowdispls, MPI_COMM_WORLD);
+        t_place = MPI_Wtime() - t_place;
+    }
+
+    if (rank == 0) {
+        report_result(opt, Afull, x, y, m, n, t_max[0]);
+        if (opt->overlap) {
+            /* Communication not hidden = time the pipeline spent waiting for it. */
+            printf("Overlap (%d chunks): pipeline %f s, communication span %f s, exposed wait "
+                   "%f s (max over ranks); hidden communication at least %f s and %.0f%% of "
+                   "the span on every rank\n",
+                   opt->overlap, t_max[3], t_span, t_max[4], t_hidden_min[0],
+                   100.0 * t_hidden_min[1]);
+        } else {
+            printf("x broadcast %f s (max over ranks), %d copy(ies) of x for %d rank(s)%s\n",
+                   t_max[1], opt->shared_x ? sv.nodes : p, p, opt->shared_x ? " (shared per node)" : "");
+            if (!opt->rma) printf("A row scatter %f s (max over ranks)\n", t_max[2]);
+        }
+        if (opt->rma) {
+            /* Ranks finish independently: fastest vs slowest fetch + compute. */
+            printf("RMA distribution (%d MPI_Rget chunks per rank): fetch + compute %f s "
+                   "(fastest rank %f s), %f s waiting for data (max over ranks)\n",
+                   opt->rma, t_max[5], t_min[0], t_max[6]);
+        }
+        if (opt->weights) {
+            long long fewest = rowcounts[0], most = rowcounts[0];
+            for (int k = 1; k < p; k++) {
+                if (rowcounts[k] < fewest) fewest = rowcounts[k];
+                if (rowcounts[k] > most) most = rowcounts[k];
+            }
+            printf("Weighted rows (%s): %lld..%lld rows per rank; local matvec fastest rank %f s, "
+                   "slowest rank %f s\n",
+                   strcmp(opt->weights, "bench") == 0 ? "calibration benchmark" : opt->weights,
+                   fewest, most, t_min[1], t_max[0]);
+        }
+        if (opt->save_weights) {
+            printf("Per-rank throughput written to %s (use --weights=%s)\n",
+                   opt->save_weights, opt->save_weights);
+        }
+        if (opt->repeat && t_rep[1] >= 0.0) {
+            printf("Repeated matvec (%d iterations, bcast + local matvec + allgatherv): "
+                   "%.2f us/iteration blocking, %.2f us/iteration persistent\n",
+                   opt->repeat, 1e6 * t_rep[0] / opt->repeat, 1e6 * t_rep[1] / opt->repeat);
+        } else if (opt->repeat) {
+            printf("Repeated matvec (%d iterations, bcast + local matvec + allgatherv): "
+                   "%.2f us/iteration (persistent collectives need MPI-4, using blocking ones)\n",
+                   opt->repeat, 1e6 * t_rep[0] / opt->repeat);
+        }
+    }
+    if (!opt->repeat) {
+        t_place = report_placement(opt->result, t_place, block_sum_squares(ylocal, local_rows));
+    }
+
+    /* --power: keep iterating on the resident A (x becomes the iterate). */
+    if (opt->power) {
+        if (m != n) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "--power needs a square matrix");
+        }
+        double lambda = 0.0;
+        int converged = 0;
+        double t_pow[5];
+        int iters = power_iteration(opt, Alocal, Qlocal, slocal, local_rows, rowdispls[rank],
+                                    x, n, rowcounts, rowdispls, ylocal, &lambda, &converged, t_pow);
+        double t_pow_max[5];
+        MPI_Reduce(t_pow, t_pow_max, 5, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            write_result("Eigenvector.txt", x, (size_t)n, 1);
+            printf("Power iteration: lambda = %.15g after %d iteration(s), %s (tol %g); "
+                   "eigenvector in Eigenvector.txt\n",
+                   lambda, iters, converged ? "converged" : "not converged", opt->tol);
+            printf("Per iteration (max over ranks): %.2f us average, fastest %.2f us, slowest %.2f us; "
+                   "local matvec %.2f us, allreduce %.2f us, allgatherv %.2f us\n",
+                   1e6 * (t_pow_max[0] + t_pow_max[1] + t_pow_max[2]) / iters,
+                   1e6 * t_pow_max[3], 1e6 * t_pow_max[4],
+                   1e6 * t_pow_max[0] / iters, 1e6 * t_pow_max[1] / iters, 1e6 * t_pow_max[2] / iters);
+        }
+    }
+
+    /* --cg: solve A z = x on the resident A; z is gathered to rank 0. */
+    if (opt->cg) {
+        if (m != n) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "--cg needs a square matrix");
+        }
+        double *xsol = (double *)matvec_alloc((size_t)(local_rows > 0 ? local_rows : 1) * sizeof(double));
+        double *full = (double *)matvec_alloc((size_t)n * sizeof(double));
+        double *hist = (rank == 0) ? (double *)malloc(((size_t)opt->cg + 1) * sizeof(double)) : NULL;
+        if (!xsol || !full || (rank == 0 && !hist)) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for CG");
+        }
+        double t_cg[4];
+        int iters = cg_solve(opt, Alocal, local_rows, rowdispls[rank], x, n, rowcounts, rowdispls,
+                             xsol, hist, full, t_cg);
+        /*
+         * Loop time of the slowest rank; the phases as means over ranks, so
+         * they add up to at most the loop time (per-phase maxima can come from
+         * different ranks and overshoot it).
+         */
+        double t_cg_max[4], t_cg_sum[3];
+        int nranks;
+        MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+        MPI_Reduce(t_cg, t_cg_max, 4, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(t_cg, t_cg_sum, 3, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        gatherv_rows(xsol, local_rows, 1, full, rowcounts, rowdispls, 0, MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            int converged = hist[iters] <= opt->tol * hist[0];
+            write_result("Solution.txt", full, (size_t)n, 1);
+            write_result("Residuals.txt", hist, (size_t)iters + 1, 1);
+            printf("CG (%s, %s preconditioner, %d MPI_Allreduce per iteration): %d iteration(s), %s, "
+                   "||r|| / ||b|| = %.3e (tol %g); solution in Solution.txt, residuals in Residuals.txt\n",
+                   opt->cg_fused ? "Chronopoulos-Gear" : "classic", opt->jacobi ? "Jacobi" : "no",
+                   opt->cg_fused ? 1 : 2, iters, converged ? "converged" : "not converged",
+                   hist[0] > 0.0 ? hist[iters] / hist[0] : 0.0, opt->tol);
+            if (iters > 0) {
+                double scale = 1e6 / ((double)iters * nranks);
+                printf("Per iteration: %.2f us (slowest rank); mean over ranks: local matvec %.2f us, "
+                       "allreduce %.2f us, allgatherv %.2f us\n",
+                       1e6 * t_cg_max[3] / iters, scale * t_cg_sum[0],
+                       scale * t_cg_sum[1], scale * t_cg_sum[2]);
+            }
+            printf("Residual history:");
+            for (int k = 0; k <= iters; k++) {
+                /* First and last few, the full history is in Residuals.txt. */
+                if (k < 5 || k > iters - 5) {
+                    printf(" %d:%.3e", k, hist[k]);
+                } else if (k == 5) {
+                    printf(" ...");
+                }
+            }
+            printf("\n");
+        }
+        matvec_free(xsol);
+        matvec_free(full);
+        free(hist);
+    }
+
+    /* --relax: Jacobi / two-color block Jacobi for A z = x; z is replicated. */
+    if (opt->relax) {
+        if (m != n) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "--relax needs a square matrix");
+        }
+        size_t lbytes = (size_t)(local_rows > 0 ? local_rows : 1) * sizeof(double);
+        double *z    = (double *)matvec_alloc((size_t)n * sizeof(double));
+        double *xnew = (double *)matvec_alloc(lbytes);
+        double *rtmp = (double *)matvec_alloc(lbytes);
+        if (!z || !xnew || !rtmp) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for relaxation");
+        }
+        double relres = 0.0;
+        int checks = 0;
+        double t_rx[4];
+        int sweeps = relax_solve(opt, Alocal, local_rows, rowdispls[rank], x, n, rowcounts, rowdispls,
+                                 z, xnew, rtmp, &relres, &checks, t_rx);
+        double t_rx_max[4];
+        MPI_Reduce(t_rx, t_rx_max, 4, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            write_result("Solution.txt", z, (size_t)n, 1);
+            printf("Relaxation (%s, dense MPI_Allgatherv exchange): %d sweep(s), %s, ||r|| / ||b|| = %.3e "
+                   "(tol %g, %d residual check(s), one every %d sweep(s)); solution in Solution.txt\n",
+                   opt->relax == 2 ? "two-color block Jacobi" : "Jacobi", sweeps,
+                   relres <= opt->tol ? "converged" : "not converged", relres, opt->tol,
+                   checks, opt->check_every);
+            printf("Per sweep (max over ranks): %.2f us; compute %.2f us, allgatherv %.2f us, "
+                   "residual checks %.2f us\n",
+                   1e6 * t_rx_max[3] / sweeps, 1e6 * t_rx_max[0] / sweeps,
+                   1e6 * t_rx_max[1] / sweeps, 1e6 * t_rx_max[2] / sweeps);
+        }
+        matvec_free(z);
+        matvec_free(xnew);
+        matvec_free(rtmp);
+    }
+
+    /* Cleanup */
+    if (opt->shared_x) {
+        shared_vector_free(&sv);
+    } else {
+        matvec_free(x);
+    }
+    matvec_free(Alocal);
+    matvec_free(Qlocal);
+    matvec_free(slocal);
+    matvec_free(ylocal);
+    matvec_free(y);
+
+    if (rank == 0) {
+        matvec_free(Afull);
+        matvec_free(Qfull);
+        matvec_free(sfull);
+    }
+    free(rowcounts);
+    free(rowdispls);
+    free(weights);
+    /* --overlap: the pipeline wall time covers x, A and the local product. */
+    return (opt->overlap ? t_max[3] : t_max[2] + t_max[1] + t_max[0]) + t_place;
+}
+
+/*
+ * Pr x Pc process grid for p ranks: as square as MPI_Dims_create makes it,
+ * with the larger grid dimension along the larger matrix dimension.
+ */
+static void grid_dims(int p, long long m, long long n, int grid[2])
+{
+    grid[0] = 0;
+    grid[1] = 0;
+    MPI_Dims_create(p, 2, grid);           /* grid[0] >= grid[1] */
+    if (n > m) {
+        int tmp = grid[0];
+        grid[0] = grid[1];
+        grid[1] = tmp;
+    }
+}
+
+/*
+ * Send rank k the block A[r0[k] : r0[k]+nr[k], c0[k] : c0[k]+nc[k]] of the
+ * row-major m x n matrix Afull held on root (a strided hvector, no packing
+ * copy). The per-rank arrays are only significant on root; every rank passes
+ * its own block shape in local_rows x local_cols and receives it contiguously.
+ */
+static void scatter_blocks(const double *Afull, long long n,
+                           const long long *r0, const long long *nr,
+                           const long long *c0, const long long *nc,
+                           double *Ablk, long long local_rows, long long local_cols,
+                           int root, MPI_Comm comm)
+{
+    int rank, p;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &p);
+
+    if (rank != root) {
+        MPI_Datatype row;
+        make_contiguous(local_cols, MPI_DOUBLE, &row);
+        MPI_Recv(Ablk, (int)local_rows, row, root, 0, comm, MPI_STATUS_IGNORE);
+        MPI_Type_free(&row);
+        return;
+    }
+
+    for (int dst = 0; dst < p; dst++) {
+        const double *src = &Afull[(size_t)r0[dst] * (size_t)n + (size_t)c0[dst]];
+
+        if (dst == root) {
+            for (long long i = 0; i < nr[dst]; i++) {
+                memcpy(&Ablk[(size_t)i * (size_t)nc[dst]], &src[(size_t)i * (size_t)n],
+                       (size_t)nc[dst] * sizeof(double));
+            }
+            continue;
+        }
+
+        MPI_Datatype block;
+        MPI_Type_create_hvector((int)nr[dst], (int)nc[dst], (MPI_Aint)((size_t)n * sizeof(double)),
+                                MPI_DOUBLE, &block);
+        MPI_Type_commit(&block);
+        MPI_Send(src, 1, block, dst, 0, comm);
+        MPI_Type_free(&block);
+    }
+}
+
+/*
+ * Partial products of a local block: y[i] = sum_j Ablk[i][j] * xblk[j].
+ *
+ * With repro != 0 the rows' global max |a_ij * x_j| is agreed on over
+ * row_comm (the ranks holding the other pieces of the same rows) and fold
+ * vectors (REPRO_FOLDS per row, see repro_dot) are written to folds instead;
+ * summing those with MPI_SUM and applying repro_fold_sum gives the same bits
+ * as the row distribution. n is the full row length.
+ */
+static void block_partial_products(const double *Ablk, long long rows, long long cols,
+                                   const double *xblk, long long n, int repro,
+                                   MPI_Comm row_comm, double *y, double *folds)
+{
+    if (!repro) {
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < rows; i++) {
+            const double *row = &Ablk[(size_t)i * (size_t)cols];
+            double sum = 0.0;
+            for (size_t j = 0; j < (size_t)cols; j++) {
+                sum += row[j] * xblk[j];
+            }
+            y[i] = sum;
+        }
+        return;
+    }
+
+    double *rowmax = (double *)matvec_alloc((size_t)rows * sizeof(double));
+    if (!rowmax) {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < rows; i++) {
+        rowmax[i] = repro_max_abs_product(&Ablk[(size_t)i * (size_t)cols], xblk, (size_t)cols);
+    }
+    /* The fold boundaries must come from the whole row, not this block. */
+    MPI_Allreduce(MPI_IN_PLACE, rowmax, (int)rows, MPI_DOUBLE, MPI_MAX, row_comm);
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < rows; i++) {
+        const double *row = &Ablk[(size_t)i * (size_t)cols];
+        double *f = &folds[(size_t)i * REPRO_FOLDS];
+        double mx = rowmax[i];
+
+        for (int k = 0; k < REPRO_FOLDS; k++) f[k] = 0.0;
+        if (mx == 0.0) continue;
+        if (!isfinite(mx) || mx > 0x1p900 || mx < 0x1p-800) {
+            /* Same fallback as repro_dot: plain partial sum. */
+            for (size_t j = 0; j < (size_t)cols; j++) f[0] += row[j] * xblk[j];
+            continue;
+        }
+
+        double sigma[REPRO_FOLDS];
+        repro_boundaries(mx, n, sigma);
+        repro_dot_folds(row, xblk, (size_t)cols, sigma, f);
+    }
+    matvec_free(rowmax);
+}
+
+/*
+ * 2D block-checkerboard distribution (--dist=2d).
+ *
+ * The p ranks form a Pr x Pc grid (MPI_Dims_create + MPI_Cart_create; the
+ * larger grid dimension goes to the larger matrix dimension). Rank (i, j)
+ * owns the block A[rows_i, cols_j] and needs only the slice x[cols_j]: rank 0
+ * scatters the slices along process row 0 and each slice is broadcast down
+ * its process column. The partial products A[rows_i, cols_j] * x[cols_j] are
+ * summed across process row i onto process column 0 and gathered to rank 0
+ * from there. Per-rank vector traffic is O(m / Pr + n / Pc) instead of O(n).
+ *
+ * With --repro each rank contributes fold vectors (see repro_dot) built from
+ * the row's global max |a_ij * x_j|, and those are summed with MPI_SUM, so y
+ * is bitwise identical to the row distribution.
+ */
+static double run_2d(const char *vec_file, const char *mat_file, long long m, long long n,
+                   const MatvecOptions *opt)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    /* Process grid; no reordering so world rank 0 stays at coordinates (0, 0). */
+    int grid[2];
+    int periods[2] = { 0, 0 };
+    int coords[2];
+    grid_dims(p, m, n, grid);
+
+    MPI_Comm cart, row_comm, col_comm;
+    MPI_Cart_create(MPI_COMM_WORLD, 2, grid, periods, 0, &cart);
+    MPI_Cart_coords(cart, rank, 2, coords);
+
+    int keep_row[2] = { 0, 1 };            /* ranks of the same process row */
+    int keep_col[2] = { 1, 0 };            /* ranks of the same process column */
+    MPI_Cart_sub(cart, keep_row, &row_comm);
+    MPI_Cart_sub(cart, keep_col, &col_comm);
+
+    /* Row blocks over process rows, column blocks over process columns. */
+    long long *rcounts = (long long *)malloc((size_t)grid[0] * sizeof(long long));
+    long long *rdispls = (long long *)malloc((size_t)grid[0] * sizeof(long long));
+    long long *ccounts = (long long *)malloc((size_t)grid[1] * sizeof(long long));
+    long long *cdispls = (long long *)malloc((size_t)grid[1] * sizeof(long long));
+    if (!rcounts || !rdispls || !ccounts || !cdispls) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for counts/displacements");
+    }
+    block_partition(m, grid[0], rcounts, rdispls);
+    block_partition(n, grid[1], ccounts, cdispls);
+
+    long long local_rows = rcounts[coords[0]];
+    long long local_cols = ccounts[coords[1]];
+    if (rcounts[0] > INT_MAX || ccounts[0] > INT_MAX) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "2D blocks with more than INT_MAX rows or columns are not supported");
+    }
+
+    /* Rank 0 loads the full x and A. */
+    double *xfull = NULL;
+    double *Afull = NULL;
+    if (rank == 0) {
+        xfull = load_vector(vec_file, (size_t)n);
+        if (!xfull) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read vector file (format/size mismatch)");
+        }
+        Afull = load_matrix(mat_file, (size_t)m, (size_t)n);
+        if (!Afull) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read matrix file (format/size mismatch)");
+        }
+    }
+
+    double *Ablk = (double *)matvec_alloc((size_t)local_rows * (size_t)local_cols * sizeof(double));
+    double *xblk = (double *)matvec_alloc((size_t)local_cols * sizeof(double));
+    double *yblk = (double *)matvec_alloc((size_t)local_rows * sizeof(double));
+    if (!Ablk || !xblk || !yblk) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for local matrix block");
+    }
+    first_touch_rows(Ablk, local_rows, (size_t)local_cols * sizeof(double));
+    first_touch_rows(yblk, local_rows, sizeof(double));
+
+    /* Per-rank block origins and shapes for scatter_blocks (rank 0 only). */
+    long long *br0 = NULL, *bnr = NULL, *bc0 = NULL, *bnc = NULL;
+    if (rank == 0) {
+        br0 = (long long *)malloc((size_t)p * sizeof(long long));
+        bnr = (long long *)malloc((size_t)p * sizeof(long long));
+        bc0 = (long long *)malloc((size_t)p * sizeof(long long));
+        bnc = (long long *)malloc((size_t)p * sizeof(long long));
+        if (!br0 || !bnr || !bc0 || !bnc) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for block table");
+        }
+        for (int k = 0; k < p; k++) {
+            int c[2];
+            MPI_Cart_coords(cart, k, 2, c);
+            br0[k] = rdispls[c[0]];
+            bnr[k] = rcounts[c[0]];
+            bc0[k] = cdispls[c[1]];
+            bnc[k] = ccounts[c[1]];
+        }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_scatter = MPI_Wtime();
+    scatter_blocks(Afull, n, br0, bnr, bc0, bnc, Ablk, local_rows, local_cols, 0, cart);
+    t_scatter = MPI_Wtime() - t_scatter;
+
+    /* x: slices along process row 0, then down each process column. */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_x = MPI_Wtime();
+    if (coords[0] == 0) {
+        scatterv_rows(xfull, ccounts, cdispls, 1, MPI_DOUBLE, xblk, local_cols, 0, row_comm);
+    }
+    bcast_x(opt, xblk, local_cols, 0, col_comm);
+    t_x = MPI_Wtime() - t_x;
+
+    /* Partial products; fold vectors instead of sums with --repro. */
+    double *folds = NULL;
+    if (opt->repro) {
+        folds = (double *)matvec_alloc((size_t)local_rows * REPRO_FOLDS * sizeof(double));
+        if (!folds) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for fold vectors");
+        }
+    }
+    double t_compute = MPI_Wtime();
+    block_partial_products(Ablk, local_rows, local_cols, xblk, n, opt->repro, row_comm, yblk, folds);
+    t_compute = MPI_Wtime() - t_compute;
+
+    /* Sum the partial results across each process row onto process column 0. */
+    double t_y = MPI_Wtime();
+    if (opt->repro) {
+        MPI_Reduce(coords[1] == 0 ? MPI_IN_PLACE : folds, folds, (int)(local_rows * REPRO_FOLDS),
+                   MPI_DOUBLE, MPI_SUM, 0, row_comm);
+        if (coords[1] == 0) {
+            for (long long i = 0; i < local_rows; i++) {
+                yblk[i] = repro_fold_sum(&folds[(size_t)i * REPRO_FOLDS]);
+            }
+        }
+    } else {
+        MPI_Reduce(coords[1] == 0 ? MPI_IN_PLACE : yblk, yblk, (int)local_rows,
+                   MPI_DOUBLE, MPI_SUM, 0, row_comm);
+    }
+    t_y = MPI_Wtime() - t_y;
+
+    double t_local[4] = { t_compute, t_x, t_y, t_scatter };
+    double t_max[4]   = { 0.0, 0.0, 0.0, 0.0 };
+    MPI_Reduce(t_local, t_max, 4, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    /*
+     * Place the row blocks of y held by process column 0: gathered to rank 0,
+     * or allgathered down column 0 and broadcast along each process row.
+     * Distributed, row block i stays on grid rank (i, 0).
+     */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_place = MPI_Wtime();
+    double *y = NULL;
+    if (coords[1] == 0) {
+        y = place_result(opt->result, yblk, local_rows, m, rcounts, rdispls, col_comm);
+    }
+    if (opt->result == RESULT_ALL) {
+        if (coords[1] != 0) {
+            y = (double *)matvec_alloc((size_t)m * sizeof(double));
+            if (!y) {
+                die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for full result y");
+            }
+        }
+        bcast_doubles(y, m, 0, row_comm);
+    }
+    t_place = MPI_Wtime() - t_place;
+
+    if (rank == 0) {
+        report_result(opt, Afull, xfull, y, m, n, t_max[0]);
+        printf("Process grid %d x %d: A scatter %f s, x column broadcast %f s, y row reduction %f s "
+               "(max over ranks)\n", grid[0], grid[1], t_max[3], t_max[1], t_max[2]);
+    }
+    t_place = report_placement(opt->result, t_place,
+                     coords[1] == 0 ? block_sum_squares(yblk, local_rows) : 0.0);
+
+    /* Cleanup */
+    matvec_free(Ablk);
+    matvec_free(xblk);
+    matvec_free(yblk);
+    matvec_free(folds);
+    matvec_free(xfull);
+    matvec_free(Afull);
+    matvec_free(y);
+    free(rcounts);
+    free(rdispls);
+    free(ccounts);
+    free(cdispls);
+    free(br0);
+    free(bnr);
+    free(bc0);
+    free(bnc);
+    MPI_Comm_free(&row_comm);
+    MPI_Comm_free(&col_comm);
+    MPI_Comm_free(&cart);
+    return t_max[3] + t_max[1] + t_max[0] + t_max[2] + t_place;
+}
+
+/*
+ * Column-block distribution (--dist=col).
+ *
+ * Rank k owns all m rows of the column block A[:, cols_k] and the matching
+ * slice x[cols_k], so x is scattered rather than broadcast. Every rank forms
+ * a full-length partial y = A[:, cols_k] * x[cols_k]; MPI_Reduce_scatter
+ * (MPI_Reduce_scatter_block when m % p == 0) sums the partials and leaves
+ * each rank with its row block of y, which is gathered to rank 0. For short
+ * and wide matrices (m << n) this moves O(m + n / p) per rank instead of O(n).
+ */
+static double run_cols(const char *vec_file, const char *mat_file, long long m, long long n,
+                     const MatvecOptions *opt)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    long long *rcounts = (long long *)malloc((size_t)p * sizeof(long long));
+    long long *rdispls = (long long *)malloc((size_t)p * sizeof(long long));
+    long long *ccounts = (long long *)malloc((size_t)p * sizeof(long long));
+    long long *cdispls = (long long *)malloc((size_t)p * sizeof(long long));
+    int       *recvcounts = (int *)malloc((size_t)p * sizeof(int));
+    if (!rcounts || !rdispls || !ccounts || !cdispls || !recvcounts) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for counts/displacements");
+    }
+    block_partition(m, p, rcounts, rdispls);   /* y blocks after the reduce-scatter */
+    block_partition(n, p, ccounts, cdispls);   /* column blocks of A and slices of x */
+
+    int per_row = opt->repro ? REPRO_FOLDS : 1;
+    if (m * per_row > INT_MAX || ccounts[0] > INT_MAX) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "column distribution needs m and n / p below INT_MAX");
+    }
+    for (int k = 0; k < p; k++) {
+        recvcounts[k] = (int)(rcounts[k] * per_row);
+    }
+
+    long long local_rows = rcounts[rank];
+    long long local_cols = ccounts[rank];
+
+    /* Rank 0 loads the full x and A. */
+    double *xfull = NULL;
+    double *Afull = NULL;
+    if (rank == 0) {
+        xfull = load_vector(vec_file, (size_t)n);
+        if (!xfull) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read vector file (format/size mismatch)");
+        }
+        Afull = load_matrix(mat_file, (size_t)m, (size_t)n);
+        if (!Afull) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "failed to read matrix file (format/size mismatch)");
+        }
+    }
+
+    double *Ablk  = (double *)matvec_alloc((size_t)m * (size_t)local_cols * sizeof(double));
+    double *xblk  = (double *)matvec_alloc((size_t)local_cols * sizeof(double));
+    double *ypart = (double *)matvec_alloc((size_t)m * (size_t)per_row * sizeof(double));
+    double *ylocal = (double *)matvec_alloc((size_t)local_rows * (size_t)per_row * sizeof(double));
+    if (!Ablk || !xblk || !ypart || !ylocal) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for local column block");
+    }
+    first_touch_rows(Ablk, m, (size_t)local_cols * sizeof(double));
+    first_touch_rows(ypart, m, (size_t)per_row * sizeof(double));
+
+    /* Every rank gets all rows of its column block. */
+    long long *zero = NULL, *all = NULL;
+    if (rank == 0) {
+        zero = (long long *)calloc((size_t)p, sizeof(long long));
+        all  = (long long *)malloc((size_t)p * sizeof(long long));
+        if (!zero || !all) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for block table");
+        }
+        for (int k = 0; k < p; k++) all[k] = m;
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_scatter = MPI_Wtime();
+    scatter_blocks(Afull, n, zero, all, cdispls, ccounts, Ablk, m, local_cols, 0, MPI_COMM_WORLD);
+    t_scatter = MPI_Wtime() - t_scatter;
+
+    /* x: each rank receives only its slice. */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_x = MPI_Wtime();
+    scatterv_rows(xfull, ccounts, cdispls, 1, MPI_DOUBLE, xblk, local_cols, 0, MPI_COMM_WORLD);
+    t_x = MPI_Wtime() - t_x;
+
+    double t_compute = MPI_Wtime();
+    block_partial_products(Ablk, m, local_cols, xblk, n, opt->repro, MPI_COMM_WORLD,
+                           ypart, opt->repro ? ypart : NULL);
+    t_compute = MPI_Wtime() - t_compute;
+
+    /* Sum the partial vectors and leave row block k of the sum on rank k. */
+    double t_y = MPI_Wtime();
+    if (m % p == 0) {
+        MPI_Reduce_scatter_block(ypart, ylocal, recvcounts[0], MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    } else {
+        MPI_Reduce_scatter(ypart, ylocal, recvcounts, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    }
+    if (opt->repro) {
+        for (long long i = 0; i < local_rows; i++) {
+            ylocal[i] = repro_fold_sum(&ylocal[(size_t)i * REPRO_FOLDS]);
+        }
+    }
+    t_y = MPI_Wtime() - t_y;
+
+    double t_local[4] = { t_compute, t_x, t_y, t_scatter };
+    double t_max[4]   = { 0.0, 0.0, 0.0, 0.0 };
+    MPI_Reduce(t_local, t_max, 4, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    /* Distributed, row block k of y stays on rank k (the x slice layout when m == n). */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t_place = MPI_Wtime();
+    double *y = place_result(opt->result, ylocal, local_rows, m, rcounts, rdispls, MPI_COMM_WORLD);
+    t_place = MPI_Wtime() - t_place;
+
+    if (rank == 0) {
+        report_result(opt, Afull, xfull, y, m, n, t_max[0]);
+        printf("Column blocks: A scatter %f s, x scatter %f s, y reduce-scatter %f s (max over ranks)\n",
+               t_max[3], t_max[1], t_max[2]);
+    }
+    t_place = report_placement(opt->result, t_place, block_sum_squares(ylocal, local_rows));
+
+    /* Cleanup */
+    matvec_free(Ablk);
+    matvec_free(xblk);
+    matvec_free(ypart);
+    matvec_free(ylocal);
+    matvec_free(xfull);
+    matvec_free(Afull);
+    matvec_free(y);
+    free(rcounts);
+    free(rdispls);
+    free(ccounts);
+    free(cdispls);
+    free(recvcounts);
+    free(zero);
+    free(all);
+    return t_max[3] + t_max[1] + t_max[0] + t_max[2] + t_place;
+}
+
+/*
+ * Automatic distribution (--dist=auto).
+ *
+ * Every distribution is modelled as a sum of Hockney terms alpha + bytes *
+ * beta per message step (binomial trees for broadcasts and reductions,
+ * root-serialized p - 1 messages for scatters and gathers) plus the local
+ * product m * n / p at the speed of the slowest rank. alpha and beta come
+ * from a ping-pong between rank 0 and rank p - 1, the speed from
+ * calibrate_rank_speed; all three are cached per machine in a small text
+ * file, so only the first run pays for the measurement.
+ */
+typedef struct {
+    double alpha;   /* seconds per message */
+    double beta;    /* seconds per byte */
+    double speed;   /* multiply-adds per second, slowest rank */
+} MachineModel;
+
+static void model_file_name(char *fname, size_t len)
+{
+    char host[MPI_MAX_PROCESSOR_NAME];
+    int host_len = 0;
+    MPI_Get_processor_name(host, &host_len);
+    for (int i = 0; i < host_len; i++) {
+        char c = host[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-')) {
+            host[i] = '_';
+        }
+    }
+    snprintf(fname, len, "MatvecModel_%s.txt", host);
+}
+
+/* Collective: measure alpha/beta between ranks 0 and p-1 and the slowest rank's speed. */
+static void measure_machine(MachineModel *mm)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    const int big = 1 << 20;
+    double t_small = 0.0, t_big = 0.0;
+    if (p > 1 && (rank == 0 || rank == p - 1)) {
+        char *buf = (char *)calloc((size_t)big, 1);
+        if (!buf) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for ping-pong buffer");
+        }
+        int peer = (rank == 0) ? p - 1 : 0;
+        for (int pass = 0; pass < 2; pass++) {
+            int bytes = (pass == 0) ? 8 : big;
+            int reps  = (pass == 0) ? 200 : 20;
+            double t_best = -1.0;    /* fastest round trip: least disturbed by noise */
+            for (int r = 0; r < reps; r++) {
+                double t = MPI_Wtime();
+                if (rank == 0) {
+                    MPI_Send(buf, bytes, MPI_BYTE, peer, 0, MPI_COMM_WORLD);
+                    MPI_Recv(buf, bytes, MPI_BYTE, peer, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                } else {
+                    MPI_Recv(buf, bytes, MPI_BYTE, peer, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                    MPI_Send(buf, bytes, MPI_BYTE, peer, 0, MPI_COMM_WORLD);
+                }
+                t = MPI_Wtime() - t;
+                if (t_best < 0.0 || t < t_best) t_best = t;
+            }
+            if (pass == 0) t_small = 0.5 * t_best; else t_big = 0.5 * t_best;   /* one way */
+        }
+        free(buf);
+    }
+    mm->alpha = t_small;
+    mm->beta  = (t_big > t_small) ? (t_big - t_small) / (double)(big - 8) : 0.0;
+
+    /* Fixed row length, so the cached value does not depend on the input. */
+    double speed = calibrate_rank_speed(4096);
+    MPI_Allreduce(MPI_IN_PLACE, &speed, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+    mm->speed = speed;
+
+    MPI_Bcast(&mm->alpha, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&mm->beta, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+}
+
+static double ceil_log2(int p)
+{
+    double steps = 0.0;
+    for (int k = 1; k < p; k *= 2) steps += 1.0;
+    return steps;
+}
+
+/* Root sends (or receives) p - 1 pieces of a total of bytes spread over p ranks. */
+static double cost_rooted(const MachineModel *mm, int p, double bytes)
+{
+    return (p - 1) * mm->alpha + bytes * (p - 1) / p * mm->beta;
+}
+
+/* Binomial tree broadcast or reduction of bytes over p ranks. */
+static double cost_tree(const MachineModel *mm, int p, double bytes)
+{
+    return ceil_log2(p) * (mm->alpha + bytes * mm->beta);
+}
+
+/*
+ * Predicted seconds for distribution kind with the --result placement of opt, and the
+ * matrix + vector bytes a non-root rank stores (*mem_bytes).
+ */
+static double predict_cost(const MachineModel *mm, DistKind kind, const MatvecOptions *opt,
+                           long long m, long long n, int p, double *mem_bytes)
+{
+    double dm = (double)m, dn = (double)n;
+    double a_bytes = 8.0 * dm * dn;
+    double t = cost_rooted(mm, p, a_bytes) + dm * dn / p / mm->speed;
+    double yfull = (opt->result == RESULT_ALL) ? 8.0 * dm : 0.0;
+
+    if (kind == DIST_2D) {
+        int grid[2];
+        grid_dims(p, m, n, grid);
+        double br = ceil(dm / grid[0]), bc = ceil(dn / grid[1]);
+        int per_row = opt->repro ? REPRO_FOLDS : 1;
+        t += cost_rooted(mm, grid[1], 8.0 * dn) + cost_tree(mm, grid[0], 8.0 * bc);
+        t += cost_tree(mm, grid[1], 8.0 * br * per_row);
+        if (opt->result == RESULT_ROOT) t += cost_rooted(mm, grid[0], 8.0 * dm);
+        if (opt->result == RESULT_ALL) {
+            t += ceil_log2(grid[0]) * mm->alpha + 8.0 * dm * (grid[0] - 1) / grid[0] * mm->beta;
+            t += cost_tree(mm, grid[1], 8.0 * dm);
+        }
+        *mem_bytes = 8.0 * (br * bc + bc + br * per_row) + yfull;
+    } else if (kind == DIST_COL) {
+        double bc = ceil(dn / p), br = ceil(dm / p);
+        int per_row = opt->repro ? REPRO_FOLDS : 1;
+        t += cost_rooted(mm, p, 8.0 * dn);
+        t += ceil_log2(p) * mm->alpha + 8.0 * dm * per_row * (p - 1) / p * mm->beta;
+        if (opt->result == RESULT_ROOT) t += cost_rooted(mm, p, 8.0 * dm);
+        if (opt->result == RESULT_ALL) t += ceil_log2(p) * mm->alpha + 8.0 * dm * (p - 1) / p * mm->beta;
+        *mem_bytes = 8.0 * (dm * bc + bc + dm * per_row + br * per_row) + yfull;
+    } else {
+        double br = ceil(dm / p);
+        t += cost_tree(mm, p, 8.0 * dn);
+        if (opt->result == RESULT_ROOT) t += cost_rooted(mm, p, 8.0 * dm);
+        if (opt->result == RESULT_ALL) t += ceil_log2(p) * mm->alpha + 8.0 * dm * (p - 1) / p * mm->beta;
+        *mem_bytes = 8.0 * (br * dn + dn + br) + yfull;
+    }
+    return t;
+}
+
+/*
+ * Collective: the machine model from the cache file (rank 0 reads it) or
+ * measured now and cached. Returns 1 when it came from fname.
+ */
+static int machine_model(MachineModel *mm, char *fname, size_t len)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int cached = 0;
+    if (rank == 0) {
+        model_file_name(fname, len);
+        FILE *f = fopen(fname, "r");
+        if (f) {
+            cached = (fscanf(f, "%lf %lf %lf", &mm->alpha, &mm->beta, &mm->speed) == 3 && mm->speed > 0.0);
+            fclose(f);
+        }
+    }
+    MPI_Bcast(&cached, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (cached) {
+        MPI_Bcast(mm, 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    } else {
+        measure_machine(mm);
+        if (rank == 0) {
+            FILE *f = fopen(fname, "w");
+            if (f) {
+                fprintf(f, "%.9g %.9g %.9g\n", mm->alpha, mm->beta, mm->speed);
+                fclose(f);
+            }
+        }
+    }
+    return cached;
+}
+
+/*
+ * Collective: load or measure the machine model, predict row, col and 2d and
+ * return the cheapest one that fits --mem-limit (same on every rank). Rank 0
+ * prints the predictions; *predicted receives the chosen one.
+ */
+static DistKind choose_distribution(const MatvecOptions *opt, long long m, long long n,
+                                    double *predicted)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    char fname[MPI_MAX_PROCESSOR_NAME + 32];
+    MachineModel mm = { 0.0, 0.0, 0.0 };
+    int cached = machine_model(&mm, fname, sizeof fname);
+
+    int choice = DIST_ROW;
+    if (rank == 0) {
+        const DistKind kinds[3] = { DIST_ROW, DIST_COL, DIST_2D };
+        double best = -1.0;
+        printf("Auto distribution model (%s): alpha %.2f us, %.3f GB/s, %.3f GMAdd/s per rank\n",
+               cached ? fname : "measured now", 1e6 * mm.alpha,
+               mm.beta > 0.0 ? 1e-9 / mm.beta : 0.0, 1e-9 * mm.speed);
+        for (int k = 0; k < 3; k++) {
+            double mem = 0.0;
+            double t = predict_cost(&mm, kinds[k], opt, m, n, p, &mem);
+            int fits = !(opt->mem_limit_mb > 0.0 && mem > opt->mem_limit_mb * 1048576.0);
+            printf("  %-3s predicted %f s, %.3f MB per rank%s\n", dist_name(kinds[k]), t,
+                   mem / 1048576.0, fits ? "" : " (over --mem-limit)");
+            if (fits && (best < 0.0 || t < best)) {
+                best = t;
+                choice = kinds[k];
+            }
+        }
+        if (best < 0.0) {
+            die_rank0_abort(MPI_COMM_WORLD, rank, "no distribution fits within --mem-limit");
+        }
+        printf("  -> using --dist=%s\n", dist_name((DistKind)choice));
+        *predicted = best;
+    }
+    MPI_Bcast(&choice, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return (DistKind)choice;
+}
+
+/*
+ * --bcast-bench: MPI_Bcast against pipelined_bcast (chain and tree, segment
+ * size of --segment) for 8 KB, 32 KB, ... up to max(64 MB, size of x), the
+ * best of 3 runs each (slowest rank). The lower bound is bytes / bandwidth of
+ * the cached ping-pong model: no broadcast can deliver faster than one link.
+ */
+static void bcast_benchmark(const MatvecOptions *opt, long long n)
+{
+    int rank, p;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &p);
+
+    char fname[MPI_MAX_PROCESSOR_NAME + 32];
+    MachineModel mm = { 0.0, 0.0, 0.0 };
+    machine_model(&mm, fname, sizeof fname);
+
+    long long max_count = (n > (8LL << 20)) ? n : (8LL << 20);
+    double *buf = (double *)matvec_alloc((size_t)max_count * sizeof(double));
+    if (!buf) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "out of memory for broadcast benchmark");
+    }
+    for (long long i = 0; i < max_count; i++) buf[i] = (double)i;
+
+    if (rank == 0) {
+        printf("Broadcast benchmark (%d ranks, %lld KB segments; seconds, slowest rank, best of 3):\n",
+               p, opt->segment * 8 / 1024);
+        printf("  %12s %12s %12s %12s %12s\n", "bytes", "MPI_Bcast", "chain", "tree", "bound");
+    }
+
+    for (long long count = 1024; ; count *= 4) {
+        if (count > max_count) count = max_count;
+        double best[3] = { -1.0, -1.0, -1.0 };
+        for (int algo = 0; algo < 3; algo++) {
+            for (int run = 0; run < 3; run++) {
+                MPI_Barrier(MPI_COMM_WORLD);
+                double t = MPI_Wtime();
+                if (algo == 0) {
+                    bcast_doubles(buf, count, 0, MPI_COMM_WORLD);
+                } else {
+                    pipelined_bcast(buf, count, opt->segment, algo == 2, 0, MPI_COMM_WORLD);
+                }
+                t = MPI_Wtime() - t;
+                MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+                if (best[algo] < 0.0 || t < best[algo]) best[algo] = t;
+            }
+        }
+        if (rank == 0) {
+            printf("  %12lld %12.6f %12.6f %12.6f %12.6f\n", count * 8, best[0], best[1], best[2],
+                   p > 1 ? (double)count * 8.0 * mm.beta : 0.0);
+        }
+        if (count == max_count) break;
+    }
+
+    matvec_free(buf);
+}
+
+int main(int argc, char **argv)
+{
+    /* OpenMP threads compute between MPI calls; only the main thread calls MPI. */
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (provided < MPI_THREAD_FUNNELED) {
+        die_rank0_abort(MPI_COMM_WORLD, rank, "MPI library does not provide MPI_THREAD_FUNNELED");
+    }
+
+    MatvecOptions opt;
+    if (argc < 3 || parse_options(argc, argv, &opt) != 0) {
+        if (rank == 0) {
+            fprintf(stderr, "Usage: %s <vector_file> <matrix_file> [--repro] "
+                            "[--bind=compact|scatter|numa|none] [--quant=int8|int16] [--verify]\n"
+                            "       [--dist=row|2d|col|auto] [--mem-limit=MB] [--shared-x] [--overlap[=K]] [--rma[=K]] [--repeat=N]\n"
+                            "       [--weights=bench|<file>] [--save-weights=<file>] [--result=root|all|dist]\n"
+                            "       [--bcast=lib|chain|tree] [--segment=KB] [--bcast-bench] [--power=N] [--tol=T]\n"
+                            "       [--cg=N] [--precond=none|jacobi] [--cg-fused]\n"
+                            "       [--relax=jacobi|twocolor] [--sweeps=N] [--check-every=K]\n"
+                            "  (--repro and --quant are mutually exclusive; --quant, --shared-x,\n"
+                            "   --overlap, --rma, --repeat and the weights options need --dist=row;\n"
+                            "   --overlap and --rma exclude --quant and each other; --overlap and\n"
+                            "   --repeat exclude --shared-x; --result=dist excludes --verify and\n"
+                            "   --repeat; --bcast=chain|tree excludes --dist=col|auto and --shared-x;\n"
+                            "   --power needs --dist=row and excludes --shared-x and --repeat;\n"
+                            "   --cg additionally excludes --power and --quant, --relax also --cg)\n",
+                    argv[0]);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    const char *vec_file = argv[1];
+    const char *mat_file = argv[2];
+
+    /* Pin before allocating so first touch happens on the final cores. */
+    if (opt.bind) {
+        topo_bind_and_report(MPI_COMM_WORLD, opt.policy);
+    }
+
+    /* dims[0] = m (rows), dims[1] = n (columns = vector length). */
+    long long dims[2] = { 0, 0 };
+
+    /* Rank 0 determines n from the vector file and m from the matrix entry count. */
+    if (rank == 0) {
+        long long n_count = count_doubles_in_file(vec_file);
+        if (n_count <= 0) {
+            fprintf(stderr, "ERROR: cannot read vector size from file '%s'\n", vec_file);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        long long a_count = count_doubles_in_file(mat_file);
+        if (a_count <= 0 || a_count % n_count != 0) {
+            fprintf(stderr, "ERROR: matrix file '%s' does not hold a whole number of %lld-column rows\n",
+                    mat_file, n_count);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        dims[0] = a_count / n_count;
+        dims[1] = n_count;
+    }
+
+    /* Broadcast m and n to all ranks. */
+    MPI_Bcast(dims, 2, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    if (opt.bcast_bench) {
+        bcast_benchmark(&opt, dims[1]);
+    }
+
+    /* --dist=auto: pick row, col or 2d from the cost model. */
+    int auto_dist = (opt.dist == DIST_AUTO);
+    double predicted = 0.0;
+    if (auto_dist) {
+        opt.dist = choose_distribution(&opt, dims[0], dims[1], &predicted);
+    }
+
+    double measured;
+    if (opt.dist == DIST_2D) {
+        measured = run_2d(vec_file, mat_file, dims[0], dims[1], &opt);
+    } else if (opt.dist == DIST_COL) {
+        measured = run_cols(vec_file, mat_file, dims[0], dims[1], &opt);
+    } else {
+        measured = run_rows(vec_file, mat_file, dims[0], dims[1], &opt);
+    }
+
+    if (auto_dist && rank == 0) {
+        printf("Auto distribution %s: predicted %f s, measured %f s "
+               "(A scatter + x + local matvec + y + placement)\n",
+               dist_name(opt.dist), predicted, measured);
     }
 
     MPI_Finalize();
@@ -39,6 +39,9 @@ rem --------------------------------------------------------------------
 set "VEC_FILE=Vector.txt"
 set "MAT_FILE=Matrix.txt"
 
+rem Extra program options, e.g. --repro, --bind=compact, --quant=int8 --verify, --dist=2d|col|auto --mem-limit=512, --shared-x, --overlap=8, --rma=8, --repeat=1000, --weights=bench, --save-weights=Weights.txt, --result=all|dist, --bcast=chain --segment=256, --bcast-bench, --power=1000 --tol=1e-12, --cg=500 --precond=jacobi --cg-fused, --relax=twocolor --check-every=10
+set "OPTIONS="
+
 rem Optional: number of MPI processes (default = 4)
 if "%~3"=="" (
     set NP=4
@@ -48,9 +51,14 @@ if "%~3"=="" (
 
 rem --------------------------------------------------------------------
 rem  Build the MPI matrix-vector program
+rem  -ffp-contract=off keeps the --repro summation free of fused multiply-adds.
+rem  -fopenmp enables the threaded first touch and compute loop
+rem  (threads per rank = OMP_NUM_THREADS).
+rem  -march=native enables the AVX2/AVX-512 dequantizing kernels of --quant.
 rem --------------------------------------------------------------------
 echo Building MPI_Matrix_Vector_General.c ...
 gcc MPI_Matrix_Vector_General.c ^
+  -O2 -ffp-contract=off -fopenmp -march=native ^
   -I"%MSMPI_INC%" ^
   -L"%MSMPI_LIB64%" ^
   -lmsmpi ^
@@ -66,8 +74,8 @@ echo Build completed successfully.
 rem --------------------------------------------------------------------
 rem  Run the MPI program
 rem --------------------------------------------------------------------
-echo Running: mpiexec -n %NP% MPI_Matrix_Vector_General.exe %VEC_FILE% %MAT_FILE%
+echo Running: mpiexec -n %NP% MPI_Matrix_Vector_General.exe %VEC_FILE% %MAT_FILE% %OPTIONS%
 echo --------------------------------------------------------------
-call mpiexec -n %NP% MPI_Matrix_Vector_General.exe "%VEC_FILE%" "%MAT_FILE%"
+call mpiexec -n %NP% MPI_Matrix_Vector_General.exe "%VEC_FILE%" "%MAT_FILE%" %OPTIONS%
 
 endlocal
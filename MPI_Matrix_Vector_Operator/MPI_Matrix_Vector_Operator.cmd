@@ -0,0 +1,68 @@
+@echo off
+setlocal
+
+rem --------------------------------------------------------------------
+rem  Modify PATH so MinGW DLLs are used first (prevents popup issues)
+rem --------------------------------------------------------------------
+set "PATH=C:\msys64\mingw64\bin;%PATH%"
+
+rem --------------------------------------------------------------------
+rem  Define Microsoft MPI include & library folders (NO trailing '\')
+rem --------------------------------------------------------------------
+set "MSMPI_INC=C:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+set "MSMPI_LIB64=C:\Program Files (x86)\Microsoft SDKs\MPI\Lib\x64"
+
+rem --------------------------------------------------------------------
+rem  Move to directory where the script is located
+rem --------------------------------------------------------------------
+cd /d %~dp0
+
+rem --------------------------------------------------------------------
+rem  Vector and operator
+rem  Usage: MPI_Matrix_Vector_Operator.cmd [num_procs] [operator] [arg]
+rem  Operators: dense <matrix_file> | laplace1d | laplace2d <nx> | gauss <width>
+rem  Generated operators can also take VEC_FILE=ones:<n> (no input files).
+rem --------------------------------------------------------------------
+set "VEC_FILE=Vector.txt"
+set "OPERATOR=dense"
+set "OP_ARG=Matrix.txt"
+
+rem Optional: number of MPI processes (default = 4)
+if "%~1"=="" (
+    set NP=4
+) else (
+    set NP=%~1
+)
+
+if not "%~2"=="" (
+    set "OPERATOR=%~2"
+    set "OP_ARG=%~3"
+)
+
+rem --------------------------------------------------------------------
+rem  Build the MPI matrix-free matrix-vector program
+rem  -O3 inlines the operator's row visitor into the matvec loop.
+rem --------------------------------------------------------------------
+echo Building MPI_Matrix_Vector_Operator.cpp ...
+g++ MPI_Matrix_Vector_Operator.cpp ^
+  -O3 ^
+  -I"%MSMPI_INC%" ^
+  -L"%MSMPI_LIB64%" ^
+  -lmsmpi ^
+  -o MPI_Matrix_Vector_Operator.exe
+
+if %errorlevel% neq 0 (
+    echo [ERROR] Compilation failed!
+    exit /b 1
+)
+
+echo Build completed successfully.
+
+rem --------------------------------------------------------------------
+rem  Run the MPI program
+rem --------------------------------------------------------------------
+echo Running: mpiexec -n %NP% MPI_Matrix_Vector_Operator.exe %VEC_FILE% %OPERATOR% %OP_ARG%
+echo --------------------------------------------------------------
+call mpiexec -n %NP% MPI_Matrix_Vector_Operator.exe "%VEC_FILE%" %OPERATOR% %OP_ARG%
+
+endlocal
@@ -0,0 +1,347 @@
+#include <stdio.h>   // For fprintf, printf
+#include <stdlib.h>  // For strtoull
+#include <string.h>  // For strcmp, strncmp
+#include <math.h>    // For exp
+#include <limits.h>  // For INT_MAX
+#include <mpi.h>     // MPI library
+
+#include "../MPI_Common/MPI_Operator.h"  // Operator interface, DenseOperator, file helpers
+
+// -----------------------------------------------------------------------------
+// Matrix-free matrix-vector multiplication: y = A * x
+// -----------------------------------------------------------------------------
+// The matvec is applyRows() from MPI_Common/MPI_Operator.h, written once
+// against the operator interface there and instantiated for each operator
+// type as a template parameter. DenseOperator is the same one
+// MPI_Matrix_Vector.cpp uses for its file-backed matrix.
+//
+// Operators provided:
+//   dense <matrix_file>  m x n rows scattered from a row-major file (the
+//                        classic path); m = number of entries / n
+//   laplace1d            tridiagonal [-1 2 -1], generated per row
+//   laplace2d <nx>       5-point Laplacian on an nx x (n / nx) grid
+//   gauss <width>        dense Gaussian kernel A(i,j) = exp(-((i-j)/width)^2 / 2)
+//
+// Generated operators have no storage and no scatter: every rank evaluates
+// A(i, j) for its own rows only, so memory per rank is O(n) (x and y).
+//
+// Usage:
+//   mpiexec -n <p> MPI_Matrix_Vector_Operator <vector> <operator> [arg]
+//
+//   <vector> is a file with n doubles, or "ones:<n>" to generate x = 1
+//   without any file. The matrix may have at most INT_MAX rows (the result
+//   is gathered with int row counts); x itself may be longer.
+//
+// Output (rank 0):
+//   Result.txt containing m doubles (space-separated); m = n for the
+//   generated operators
+// -----------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+// Generated operators
+// -----------------------------------------------------------------------------
+
+// 1D Laplacian: 2 on the diagonal, -1 on the first off-diagonals.
+struct Laplace1DOperator
+{
+    size_t n;
+
+    size_t rows() const { return n; }
+
+    template <class Visit>
+    void row(size_t i, Visit visit) const
+    {
+        if (i > 0)
+            visit(i - 1, -1.0);
+        visit(i, 2.0);
+        if (i + 1 < n)
+            visit(i + 1, -1.0);
+    }
+};
+
+// 2D 5-point Laplacian on an nx x ny grid, row-major numbering i = r * nx + c.
+struct Laplace2DOperator
+{
+    size_t nx;
+    size_t ny;
+
+    size_t rows() const { return nx * ny; }
+
+    template <class Visit>
+    void row(size_t i, Visit visit) const
+    {
+        size_t r = i / nx;
+        size_t c = i % nx;
+        if (r > 0)
+            visit(i - nx, -1.0);
+        if (c > 0)
+            visit(i - 1, -1.0);
+        visit(i, 4.0);
+        if (c + 1 < nx)
+            visit(i + 1, -1.0);
+        if (r + 1 < ny)
+            visit(i + nx, -1.0);
+    }
+};
+
+// Dense Gaussian kernel matrix, every entry computed on the fly.
+struct GaussKernelOperator
+{
+    size_t n;
+    double width;
+
+    size_t rows() const { return n; }
+
+    template <class Visit>
+    void row(size_t i, Visit visit) const
+    {
+        double inv = 1.0 / width;
+        for (size_t j = 0; j != n; ++j)
+        {
+            double d = ((double)i - (double)j) * inv;
+            visit(j, exp(-0.5 * d * d));
+        }
+    }
+};
+
+// -----------------------------------------------------------------------------
+// main
+// -----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    int csize;  // total number of MPI processes
+    int prank;  // rank (ID) of this MPI process
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &csize);
+    MPI_Comm_rank(MPI_COMM_WORLD, &prank);
+
+    const char* vspec = (argc > 1) ? argv[1] : "";
+    const char* opname = (argc > 2) ? argv[2] : "";
+    const char* oparg = (argc > 3) ? argv[3] : NULL;
+
+    bool known = strcmp(opname, "dense") == 0 || strcmp(opname, "laplace1d") == 0 ||
+                 strcmp(opname, "laplace2d") == 0 || strcmp(opname, "gauss") == 0;
+    bool needsArg = strcmp(opname, "laplace1d") != 0;
+
+    if (argc < 3 || !known || (needsArg && !oparg))
+    {
+        if (prank == 0)
+            fprintf(stderr,
+                    "Usage: %s <vector_file|ones:n> dense <matrix_file>\n"
+                    "       %s <vector_file|ones:n> laplace1d\n"
+                    "       %s <vector_file|ones:n> laplace2d <nx>\n"
+                    "       %s <vector_file|ones:n> gauss <width>\n",
+                    argv[0], argv[0], argv[0], argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Vector length: from the file (rank 0) or from "ones:<n>"
+    bool generated = strncmp(vspec, "ones:", 5) == 0;
+    long long dimll = 0;
+    if (generated)
+        dimll = strtoll(vspec + 5, NULL, 10);
+    else if (prank == 0)
+        dimll = returnSize(vspec);
+
+    MPI_Bcast(&dimll, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    if (dimll <= 0)
+    {
+        if (prank == 0)
+            fprintf(stderr, "ERROR: cannot determine vector size from '%s'\n", vspec);
+        MPI_Finalize();
+        return 1;
+    }
+    size_t dim = (size_t)dimll;
+
+    // Matrix rows: the dense file holds m rows of n = dim entries (m != n is
+    // fine); the generated operators are square.
+    bool dense = strcmp(opname, "dense") == 0;
+    long long rowsll = dimll;
+    if (dense && prank == 0)
+    {
+        long long entries = returnSize(oparg);
+        if (entries <= 0 || entries % dimll != 0 || entries / dimll > INT_MAX)
+        {
+            fprintf(stderr, "ERROR: matrix file '%s' is missing or does not hold a whole number "
+                    "(1..INT_MAX) of rows of %lld values\n", oparg, dimll);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        rowsll = entries / dimll;
+    }
+    MPI_Bcast(&rowsll, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+
+    // Row counts and displacements of the result MPI_Gatherv are ints, so a
+    // generated operator (m = n from "ones:<n>") is limited like the file.
+    if (rowsll > INT_MAX)
+    {
+        if (prank == 0)
+            fprintf(stderr, "ERROR: m = %lld rows exceeds INT_MAX\n", rowsll);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    size_t m = (size_t)rowsll;
+
+    // Uneven row distribution: rank r owns rows [rowBegin, rowEnd)
+    size_t q = m / csize;
+    size_t r = m % csize;
+    size_t localRows = q + ((size_t)prank < r ? 1 : 0);
+    size_t rowBegin  = (size_t)prank * q + ((size_t)prank < r ? (size_t)prank : r);
+    size_t rowEnd    = rowBegin + localRows;
+
+    // Every rank needs the full x (O(n) memory)
+    MPI_Datatype rowType;
+    makeRowType(dimll, &rowType);
+
+    double* vec;
+    if (generated)
+    {
+        vec = allocDoubles(dim);
+        if (!vec)
+        {
+            fprintf(stderr, "ERROR: out of memory for the vector\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        for (size_t j = 0; j != dim; ++j)
+            vec[j] = 1.0;
+    }
+    else
+    {
+        vec = (prank == 0) ? loadDoubles(vspec, dim) : allocDoubles(dim);
+        if (!vec)
+        {
+            fprintf(stderr, "ERROR: failed to read vector file '%s'\n", vspec);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        MPI_Bcast(vec, 1, rowType, 0, MPI_COMM_WORLD);
+    }
+
+    double* lres = allocDoubles(localRows);
+    if (!lres)
+    {
+        fprintf(stderr, "ERROR: rank %d out of memory for %zu result rows\n", prank, localRows);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    double* mat = NULL;  // only the dense operator stores matrix rows
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+
+    if (dense)
+    {
+        // Dense path: rank 0 loads the file and scatters row blocks
+        double* tmat = NULL;
+        int* counts = NULL;
+        int* displs = NULL;
+        if (prank == 0)
+        {
+            tmat = loadDoubles(oparg, m * dim);
+            if (!tmat)
+            {
+                fprintf(stderr, "ERROR: failed to read %zu x %zu matrix from '%s' "
+                        "(missing file or too few values)\n", m, dim, oparg);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            counts = new int[csize];
+            displs = new int[csize];
+            for (int k = 0; k != csize; ++k)
+            {
+                counts[k] = (int)(q + ((size_t)k < r ? 1 : 0));
+                displs[k] = (int)((size_t)k * q + ((size_t)k < r ? (size_t)k : r));
+            }
+        }
+
+        mat = allocDoubles(localRows * dim);
+        if (!mat)
+        {
+            fprintf(stderr, "ERROR: rank %d out of memory for %zu matrix rows\n", prank, localRows);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        MPI_Scatterv(tmat, counts, displs, rowType,
+                     mat, (int)localRows, rowType, 0, MPI_COMM_WORLD);
+
+        freeDoubles(tmat);
+        delete[] counts;
+        delete[] displs;
+
+        DenseOperator A = { m, dim, rowBegin, mat };
+        applyRows(A, rowBegin, rowEnd, vec, lres);
+    }
+    else if (strcmp(opname, "laplace1d") == 0)
+    {
+        Laplace1DOperator A = { dim };
+        applyRows(A, rowBegin, rowEnd, vec, lres);
+    }
+    else if (strcmp(opname, "laplace2d") == 0)
+    {
+        size_t nx = (size_t)strtoull(oparg, NULL, 10);
+        if (nx == 0 || dim % nx != 0)
+        {
+            if (prank == 0)
+                fprintf(stderr, "ERROR: n = %zu is not a multiple of nx = %zu\n", dim, nx);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        Laplace2DOperator A = { nx, dim / nx };
+        applyRows(A, rowBegin, rowEnd, vec, lres);
+    }
+    else
+    {
+        double width = atof(oparg);
+        if (!(width > 0.0))
+        {
+            if (prank == 0)
+                fprintf(stderr, "ERROR: kernel width must be positive\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        GaussKernelOperator A = { dim, width };
+        applyRows(A, rowBegin, rowEnd, vec, lres);
+    }
+
+    double duration = MPI_Wtime() - start;
+    double maxDuration;
+    MPI_Reduce(&duration, &maxDuration, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    // Gather the result rows on rank 0
+    double* res = NULL;
+    int* rcounts = NULL;
+    int* rdispls = NULL;
+    if (prank == 0)
+    {
+        res = allocDoubles(m);
+        if (!res)
+        {
+            fprintf(stderr, "ERROR: out of memory for the result vector\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        rcounts = new int[csize];
+        rdispls = new int[csize];
+        for (int k = 0; k != csize; ++k)
+        {
+            rcounts[k] = (int)(q + ((size_t)k < r ? 1 : 0));
+            rdispls[k] = (int)((size_t)k * q + ((size_t)k < r ? (size_t)k : r));
+        }
+    }
+
+    MPI_Gatherv(lres, (int)localRows, MPI_DOUBLE,
+                res, rcounts, rdispls, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (prank == 0)
+    {
+        logRes("Result.txt", res, m);
+        printf("Operator %s, %zu x %zu: matrix storage per rank = %zu doubles, "
+               "time (max over ranks) = %f seconds\n",
+               opname, m, dim, mat ? localRows * dim : (size_t)0, maxDuration);
+    }
+
+    // Clean-up
+    MPI_Type_free(&rowType);
+    freeDoubles(vec);
+    freeDoubles(mat);
+    freeDoubles(lres);
+    freeDoubles(res);
+    delete[] rcounts;
+    delete[] rdispls;
+
+    MPI_Finalize();
+    return 0;
+}
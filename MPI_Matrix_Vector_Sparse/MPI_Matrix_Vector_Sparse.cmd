@@ -0,0 +1,64 @@
+@echo off
+setlocal
+
+rem --------------------------------------------------------------------
+rem  Modify PATH so MinGW DLLs are used first (prevents popup issues)
+rem --------------------------------------------------------------------
+set "PATH=C:\msys64\mingw64\bin;%PATH%"
+
+rem --------------------------------------------------------------------
+rem  Define Microsoft MPI include & library folders (NO trailing '\')
+rem --------------------------------------------------------------------
+set "MSMPI_INC=C:\Program Files (x86)\Microsoft SDKs\MPI\Include"
+set "MSMPI_LIB64=C:\Program Files (x86)\Microsoft SDKs\MPI\Lib\x64"
+
+rem --------------------------------------------------------------------
+rem  Move to directory where the script is located
+rem --------------------------------------------------------------------
+cd /d %~dp0
+
+rem --------------------------------------------------------------------
+rem  Input files
+rem  Usage: MPI_Matrix_Vector_Sparse.cmd [num_procs]
+rem  Matrix.mtx holds a 2D Laplacian in Matrix Market coordinate format.
+rem --------------------------------------------------------------------
+set "VEC_FILE=Vector.txt"
+set "MAT_FILE=Matrix.mtx"
+
+rem Storage format: csr or sell (SELL-C-sigma, SIMD width chosen at build time)
+set "FORMAT=sell"
+
+rem Optional: number of MPI processes (default = 4)
+if "%~1"=="" (
+    set NP=4
+) else (
+    set NP=%~1
+)
+
+rem --------------------------------------------------------------------
+rem  Build the MPI sparse matrix-vector program
+rem  -march=native enables the AVX2 / AVX-512 SELL kernels on this CPU.
+rem --------------------------------------------------------------------
+echo Building MPI_Matrix_Vector_Sparse.c ...
+gcc MPI_Matrix_Vector_Sparse.c ^
+  -O3 -march=native ^
+  -I"%MSMPI_INC%" ^
+  -L"%MSMPI_LIB64%" ^
+  -lmsmpi ^
+  -o MPI_Matrix_Vector_Sparse.exe
+
+if %errorlevel% neq 0 (
+    echo [ERROR] Compilation failed!
+    exit /b 1
+)
+
+echo Build completed successfully.
+
+rem --------------------------------------------------------------------
+rem  Run the MPI program
+rem --------------------------------------------------------------------
+echo Running: mpiexec -n %NP% MPI_Matrix_Vector_Sparse.exe %VEC_FILE% %MAT_FILE% %FORMAT%
+echo --------------------------------------------------------------
+call mpiexec -n %NP% MPI_Matrix_Vector_Sparse.exe "%VEC_FILE%" "%MAT_FILE%" %FORMAT%
+
+endlocal
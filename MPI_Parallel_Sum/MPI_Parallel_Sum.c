@@ -1,6 +1,12 @@
+#if defined(__linux__)
+#define _GNU_SOURCE  // For sched_setaffinity (used by MPI_Topology.h)
+#endif
+
 #include <stdio.h>   // For printf, scanf, fflush
 #include <mpi.h>     // For MPI functions
 
+#include "../MPI_Common/MPI_Topology.h"  // Rank pinning + placement report
+
 // -----------------------------------------------------------------------------
 // getInput
 // -----------------------------------------------------------------------------
@@ -47,6 +53,8 @@ double getInput()
 //
 // Command-line arguments:
 //   None required. Rank 0 prompts the user for the input `n`.
+//   Optional argv[1]: pinning policy (none | compact | scatter | numa).
+//   Ranks are bound before timing starts, so repeated runs are comparable.
 // -----------------------------------------------------------------------------
 int main(int argc, char* argv[])
 {
@@ -61,6 +69,20 @@ int main(int argc, char* argv[])
     MPI_Comm_size(MPI_COMM_WORLD, &csize);
     MPI_Comm_rank(MPI_COMM_WORLD, &prank);
 
+    // ---------------------------------------------------------------------------------
+    // Optional rank pinning (prints topology and placement map on rank 0)
+    // ---------------------------------------------------------------------------------
+    if (argc > 1) {
+        TopoBindPolicy policy;
+        if (topo_parse_policy(argv[1], &policy) != 0) {
+            if (prank == 0)
+                fprintf(stderr, "Usage: %s [none|compact|scatter|numa]\n", argv[0]);
+            MPI_Finalize();
+            return 1;
+        }
+        topo_bind_and_report(MPI_COMM_WORLD, policy);
+    }
+
     // ---------------------------------------------------------------------------------
     // Input stage (only rank 0 prompts the user)
     // ---------------------------------------------------------------------------------
@@ -10,10 +10,14 @@ set "MSMPI_LIB64=C:\Program Files (x86)\Microsoft SDKs\MPI\Lib\x64"
 
 cd /d %~dp0
 
+rem Rank/thread pinning policy: none | compact | scatter | numa (first argument overrides)
+set "BIND=compact"
+if not "%~1"=="" set "BIND=%~1"
+
 rem Build MPI program with MinGW g++ + MSMPI
 echo Building MPI_Parallel_Sum...
 gcc MPI_Parallel_Sum.c -I"%MSMPI_INC%" -L"%MSMPI_LIB64%" -lmsmpi -o MPI_Parallel_Sum.exe
 
-call mpiexec -n 4 MPI_Parallel_Sum.exe
+call mpiexec -n 4 MPI_Parallel_Sum.exe %BIND%
 
 endlocal